@@ -2,19 +2,20 @@
 
 set -e
 
-# We are using eth0 and eth1 as EmuFdNetDevices in ns3.
+# We are using eth0 and eth1 (and, with more client / server pairs, eth2,
+# eth3, ...) as EmuFdNetDevices in ns3.
 # Use promiscuous mode to allow ns3 to capture all packets.
-ifconfig eth0 promisc
-ifconfig eth1 promisc
+IFACES=$(ls /sys/class/net | grep '^eth')
+for IFACE in $IFACES; do
+  ifconfig $IFACE promisc
+done
 
 # A packet arriving at eth0 destined to 10.100.0.0/16 could be routed directly to eth1,
 # and a packet arriving at eth1 destined to 10.0.0.0/16 directly to eth0.
 # This would allow packets to skip the ns3 simulator altogether.
 # Drop those to make sure they actually take the path through ns3.
-iptables -A FORWARD -i eth0 -o eth1 -j DROP
-iptables -A FORWARD -i eth1 -o eth0 -j DROP
-ip6tables -A FORWARD -i eth0 -o eth1 -j DROP
-ip6tables -A FORWARD -i eth1 -o eth0 -j DROP
+iptables -A FORWARD -i eth+ -o eth+ -j DROP
+ip6tables -A FORWARD -i eth+ -o eth+ -j DROP
 
 if [[ -n "$WAITFORSERVER" ]]; then
   wait-for-it-quic -t 10s $WAITFORSERVER
@@ -24,6 +25,11 @@ echo "Using scenario:" $SCENARIO
 
 tcpdump -i eth0 -U -w "/logs/trace_node_left.pcap" &
 tcpdump -i eth1 -U -w "/logs/trace_node_right.pcap" &
+for IFACE in $IFACES; do
+  if [[ "$IFACE" != "eth0" && "$IFACE" != "eth1" ]]; then
+    tcpdump -i $IFACE -U -w "/logs/trace_$IFACE.pcap" &
+  fi
+done
 eval ./scratch/"$SCENARIO &"
 
 PID=`jobs -p`
@@ -5,6 +5,7 @@
 #include "ns3/traffic-control-module.h"
 #include "../helper/quic-network-simulator-helper.h"
 #include "../helper/quic-point-to-point-helper.h"
+#include "../helper/event-log.h"
 #include <cmath>
 
 using namespace ns3;
@@ -69,7 +70,8 @@ void SwitchToLowBandwidth();
 void SwitchToHighBandwidth();
 
 void SwitchToHighBandwidth() {
-  std::cout << Simulator::Now().GetSeconds() << "s: 切换到高带宽: " << g_config.high_bandwidth << std::endl;
+  EventRecord r = EventLog::LinkRateRecord(kLinkRateHigh, DataRate(g_config.high_bandwidth).GetBitRate());
+  EventLog::Get().Log(r);
   // 更新设备的数据速率
   g_p2p_left->SetDataRate(DataRate(g_config.high_bandwidth));
   g_p2p_right->SetDataRate(DataRate(g_config.high_bandwidth));
@@ -77,7 +79,8 @@ void SwitchToHighBandwidth() {
 }
 
 void SwitchToLowBandwidth() {
-  std::cout << Simulator::Now().GetSeconds() << "s: 切换到低带宽: " << g_config.low_bandwidth << std::endl;
+  EventRecord r = EventLog::LinkRateRecord(kLinkRateLow, DataRate(g_config.low_bandwidth).GetBitRate());
+  EventLog::Get().Log(r);
   // 更新设备的数据速率
   g_p2p_left->SetDataRate(DataRate(g_config.low_bandwidth));
   g_p2p_right->SetDataRate(DataRate(g_config.low_bandwidth));
@@ -87,7 +90,6 @@ void SwitchToLowBandwidth() {
 // 线性变化函数
 void LinearBandwidthChange() {
   // 计算新带宽
-  double current_time = Simulator::Now().GetSeconds();
   g_config.current_bandwidth -= g_config.bandwidth_change_rate;
   
   // 确保带宽在高低带宽范围内
@@ -100,7 +102,8 @@ void LinearBandwidthChange() {
     g_config.current_bandwidth = high_bw;
     g_config.bandwidth_change_rate = -g_config.bandwidth_change_rate;
   }
-  std::cout << current_time << "s: 线性变化带宽: " << MbpsToBandwidth(g_config.current_bandwidth) << std::endl;
+  EventRecord r = EventLog::LinkRateRecord(kLinkRateLinear, g_config.current_bandwidth * 1e6);
+  EventLog::Get().Log(r);
   
   // 更新设备的数据速率
   g_p2p_left->SetDataRate(DataRate(MbpsToBandwidth(g_config.current_bandwidth)));
@@ -114,7 +117,8 @@ void PeriodicBandwidthChange() {
   double current_time = Simulator::Now().GetSeconds();
   double bandwidth = g_config.mean_bandwidth + 
                      g_config.amplitude * std::sin(2 * M_PI * current_time / g_config.period);
-  std::cout << current_time << "s: 周期变化带宽: " << MbpsToBandwidth(bandwidth) << std::endl;
+  EventRecord r = EventLog::LinkRateRecord(kLinkRatePeriodic, bandwidth * 1e6);
+  EventLog::Get().Log(r);
   
   // 更新设备的数据速率
   g_p2p_left->SetDataRate(DataRate(MbpsToBandwidth(bandwidth)));
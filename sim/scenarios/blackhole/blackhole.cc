@@ -4,7 +4,8 @@
 #include "ns3/point-to-point-module.h"
 #include "../helper/quic-network-simulator-helper.h"
 #include "../helper/quic-point-to-point-helper.h"
-#include "blackhole-error-model.h"
+#include "../helper/blackhole-error-model.h"
+#include "../helper/event-log.h"
 
 using namespace ns3;
 
@@ -13,7 +14,8 @@ NS_LOG_COMPONENT_DEFINE("ns3 simulator");
 void enable(Ptr<BlackholeErrorModel> em, const Time next, const int repeat) {
   static int counter = 0;
   counter++;
-  std::cout << Simulator::Now().GetSeconds() << "s: Enabling blackhole" << std::endl;
+  EventRecord r = EventLog::Record(kEventBlackholeOn);
+  EventLog::Get().Log(r);
   em->Enable();
   if(counter < repeat) {
     Simulator::Schedule(next, &enable, em, next, repeat);
@@ -22,7 +24,8 @@ void enable(Ptr<BlackholeErrorModel> em, const Time next, const int repeat) {
 
 void disable(Ptr<BlackholeErrorModel> em, const Time next, const int repeat) {
   static int counter = 0;
-  std::cout << Simulator::Now().GetSeconds() << "s: Disabling blackhole" << std::endl;
+  EventRecord r = EventLog::Record(kEventBlackholeOff);
+  EventLog::Get().Log(r);
   counter++;
   em->Disable();
   if(counter < repeat) {
@@ -3,6 +3,7 @@
 #include "ns3/simulator.h"
 #include "ns3/pointer.h"
 #include "ns3/data-rate.h"
+#include "../helper/event-log.h"
 
 NS_LOG_COMPONENT_DEFINE("ComplexChannel");
 
@@ -69,7 +70,8 @@ void
 ComplexChannel::SwitchToHighBandwidth(void)
 {
   NS_LOG_FUNCTION(this);
-  std::cout << Simulator::Now().GetSeconds() << "s: 切换到高带宽: " << m_highBandwidth << std::endl;
+  EventRecord r = EventLog::LinkRateRecord(kLinkRateHigh, m_highBandwidth.GetBitRate());
+  EventLog::Get().Log(r);
   m_currentBandwidth = m_highBandwidth;
   
   // 调度下一次带宽变化
@@ -80,7 +82,8 @@ void
 ComplexChannel::SwitchToLowBandwidth(void)
 {
   NS_LOG_FUNCTION(this);
-  std::cout << Simulator::Now().GetSeconds() << "s: 切换到低带宽: " << m_lowBandwidth << std::endl;
+  EventRecord r = EventLog::LinkRateRecord(kLinkRateLow, m_lowBandwidth.GetBitRate());
+  EventLog::Get().Log(r);
   m_currentBandwidth = m_lowBandwidth;
   
   // 调度下一次带宽变化
@@ -99,11 +102,12 @@ ComplexChannel::TransmitStart(Ptr<const Packet> p, Ptr<PointToPointNetDevice> sr
   Time delay = GetDelay();
   
   // 如果设置了抖动，添加随机抖动
+  Time jitterDelay;
   if (m_jitter)
   {
     // 生成随机抖动，单位为毫秒
     double jitterMs = m_jitter->GetValue();
-    Time jitterDelay = MilliSeconds(jitterMs);
+    jitterDelay = MilliSeconds(jitterMs);
     delay += jitterDelay;
     NS_LOG_INFO("添加抖动: " << jitterMs << "ms，总延迟: " << delay.GetMilliSeconds() << "ms");
   }
@@ -111,6 +115,17 @@ ComplexChannel::TransmitStart(Ptr<const Packet> p, Ptr<PointToPointNetDevice> sr
   // 计算传输延迟（基于当前带宽）
   Time transmissionDelay = Seconds(p->GetSize() * 8.0 / m_currentBandwidth.GetBitRate());
   NS_LOG_INFO("传输延迟: " << transmissionDelay.GetMilliSeconds() << "ms（基于带宽" << m_currentBandwidth << "）");
+
+  // 记录每个数据包的抖动和传输延迟
+  EventLog &log = EventLog::Get();
+  if (log.IsEnabled(EventLog::kPackets))
+  {
+    EventRecord r = EventLog::Record(kEventChannelDelay);
+    r.size = p->GetSize();
+    r.arg[0] = jitterDelay.GetMicroSeconds();
+    r.arg[1] = transmissionDelay.GetMicroSeconds();
+    log.Log(r);
+  }
   
   // 调度接收事件（传播延迟 + 传输延迟）
   Simulator::ScheduleWithContext(dst->GetNode()->GetId(),
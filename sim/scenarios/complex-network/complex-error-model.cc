@@ -5,6 +5,7 @@
 #include "ns3/boolean.h"
 #include "ns3/pointer.h"
 #include "ns3/uinteger.h"
+#include "../helper/event-log.h"
 
 NS_LOG_COMPONENT_DEFINE("ComplexErrorModel");
 
@@ -57,6 +58,7 @@ ComplexErrorModel::ComplexErrorModel()
     m_dropRate(0.0),
     m_dropBurstSize(0),
     m_maxDropBurstSize(1),
+    m_dropRng("ComplexErrorModel"),
     m_cyclicDropEnabled(false),
     m_cyclicDropPeriod(Seconds(10)),
     m_cyclicDropDuration(Seconds(1)),
@@ -64,9 +66,6 @@ ComplexErrorModel::ComplexErrorModel()
     m_nextCyclicDropEnd(Seconds(0))
 {
   NS_LOG_FUNCTION(this);
-  // 初始化丢包随机数生成器
-  m_dropRng = CreateObject<UniformRandomVariable>();
-  
   // 设置第一次周期性丢包的时间
   if (m_cyclicDropEnabled) {
     m_nextCyclicDropStart = Simulator::Now() + m_cyclicDropPeriod;
@@ -140,6 +139,19 @@ ComplexErrorModel::GetJitterDelay(void)
   return MilliSeconds(jitterMs);
 }
 
+void
+ComplexErrorModel::LogDrop(uint16_t reason, uint32_t burst)
+{
+  EventLog &log = EventLog::Get();
+  if (!log.IsEnabled(EventLog::kPackets)) {
+    return;
+  }
+  EventRecord r = EventLog::Record(kEventComplexDrop);
+  r.arg16 = reason;
+  r.arg[0] = burst;
+  log.Log(r);
+}
+
 bool
 ComplexErrorModel::DoCorrupt(Ptr<Packet> p)
 {
@@ -152,6 +164,7 @@ ComplexErrorModel::DoCorrupt(Ptr<Packet> p)
     // 如果现在正处于丢包周期内
     if (now >= m_nextCyclicDropStart && now < m_nextCyclicDropEnd) {
       NS_LOG_INFO("周期性丢包: 在时间 " << now.GetSeconds() << "s");
+      LogDrop(kComplexDropCyclic, 0);
       return true; // 丢弃数据包
     }
     
@@ -169,18 +182,20 @@ ComplexErrorModel::DoCorrupt(Ptr<Packet> p)
       // 减少连续丢包计数
       m_dropBurstSize--;
       NS_LOG_INFO("随机丢包: 连续丢包还剩 " << m_dropBurstSize << " 个");
+      LogDrop(kComplexDropBurst, m_dropBurstSize);
       return true; // 丢弃数据包
     }
     
     // 根据丢包率决定是否丢包
-    double rng = m_dropRng->GetValue();
+    double rng = 1 - m_dropRng.Uniform();
     if (rng < m_dropRate) {
       // 如果最大连续丢包数大于1，可能触发连续丢包
       if (m_maxDropBurstSize > 1) {
         // 随机确定这次连续丢包的数量
-        m_dropBurstSize = m_dropRng->GetInteger(0, m_maxDropBurstSize - 1);
+        m_dropBurstSize = m_dropRng.Between(0, m_maxDropBurstSize - 1);
         NS_LOG_INFO("随机丢包: 触发连续丢包，将丢弃 " << (m_dropBurstSize + 1) << " 个包");
       }
+      LogDrop(kComplexDropRandom, m_dropBurstSize);
       return true; // 丢弃数据包
     }
   }
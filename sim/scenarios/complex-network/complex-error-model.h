@@ -4,6 +4,7 @@
 #include "ns3/error-model.h"
 #include "ns3/random-variable-stream.h"
 #include "ns3/nstime.h"
+#include "../helper/random-source.h"
 
 using namespace ns3;
 
@@ -41,11 +42,14 @@ public:
   virtual bool DoCorrupt (Ptr<Packet> p);
   
 private:
+  // 将丢包事件写入事件日志
+  void LogDrop (uint16_t reason, uint32_t burst);
+
   // 随机丢包相关参数
   double m_dropRate;             // 丢包率
   uint32_t m_dropBurstSize;      // 当前连续丢包的数量
   uint32_t m_maxDropBurstSize;   // 最大连续丢包数
-  Ptr<UniformRandomVariable> m_dropRng;  // 丢包随机数生成器
+  RandomStream m_dropRng;        // 丢包随机数生成器
   
   // 周期性丢包相关参数
   bool m_cyclicDropEnabled;      // 是否启用周期性丢包
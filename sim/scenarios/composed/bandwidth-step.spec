@@ -0,0 +1,8 @@
+# The bandwidth drops from 10Mbps to 1Mbps after 10s, and recovers after 20s.
+# The queue is managed by FQ-CoDel.
+bandwidth = 10Mbps
+delay = 15ms
+queue = 100
+queue_disc = ns3::FqCoDelQueueDisc
+at 10s set link DataRate 1Mbps
+at 20s set link DataRate 10Mbps
@@ -0,0 +1,24 @@
+#include "ns3/core-module.h"
+#include "../helper/quic-network-simulator-helper.h"
+#include "../helper/scenario-spec.h"
+
+using namespace ns3;
+using namespace std;
+
+NS_LOG_COMPONENT_DEFINE("ns3 simulator");
+
+int main(int argc, char *argv[]) {
+    std::string spec_file;
+    CommandLine cmd;
+
+    cmd.AddValue("spec", "the scenario spec file", spec_file);
+    cmd.Parse (argc, argv);
+
+    NS_ABORT_MSG_IF(spec_file.length() == 0, "Missing parameter: spec");
+    ScenarioSpec spec = ScenarioSpec::Load(spec_file);
+
+    QuicNetworkSimulatorHelper sim;
+    spec.Build(sim);
+
+    sim.Run(spec.GetDuration());
+}
@@ -0,0 +1,7 @@
+# Like the drop-rate scenario: random loss in both directions, but no more
+# than 3 packets in a row.
+bandwidth = 10Mbps
+delay = 15ms
+queue = 25
+to_client = drop:rate=10,burst=3
+to_server = drop:rate=20,burst=3
@@ -4,7 +4,7 @@
 #include "ns3/point-to-point-module.h"
 #include "../helper/quic-network-simulator-helper.h"
 #include "../helper/quic-point-to-point-helper.h"
-#include "corrupt-rate-error-model.h"
+#include "../helper/corrupt-rate-error-model.h"
 
 using namespace ns3;
 using namespace std;
@@ -14,8 +14,6 @@ NS_LOG_COMPONENT_DEFINE("ns3 simulator");
 int main(int argc, char *argv[]) {
     std::string delay, bandwidth, queue, client_rate, server_rate,
         client_burst, server_burst;
-    std::random_device rand_dev;
-    std::mt19937 generator(rand_dev());  // Seed random number generator first
     Ptr<CorruptRateErrorModel> client_corrupts = CreateObject<CorruptRateErrorModel>();
     Ptr<CorruptRateErrorModel> server_corrupts = CreateObject<CorruptRateErrorModel>();
     CommandLine cmd;
@@ -57,6 +55,8 @@ int main(int argc, char *argv[]) {
     
     NetDeviceContainer devices = p2p.Install(sim.GetLeftNode(), sim.GetRightNode());
     
+    client_corrupts->SetCounters(CounterRegistry::Get().GetDirection("to_client"));
+    server_corrupts->SetCounters(CounterRegistry::Get().GetDirection("to_server"));
     devices.Get(0)->SetAttribute("ReceiveErrorModel", PointerValue(client_corrupts));
     devices.Get(1)->SetAttribute("ReceiveErrorModel", PointerValue(server_corrupts));
     
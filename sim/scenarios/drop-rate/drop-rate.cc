@@ -4,7 +4,7 @@
 #include "ns3/point-to-point-module.h"
 #include "../helper/quic-network-simulator-helper.h"
 #include "../helper/quic-point-to-point-helper.h"
-#include "drop-rate-error-model.h"
+#include "../helper/drop-rate-error-model.h"
 
 using namespace ns3;
 using namespace std;
@@ -14,8 +14,6 @@ NS_LOG_COMPONENT_DEFINE("ns3 simulator");
 int main(int argc, char *argv[]) {
     std::string delay, bandwidth, queue, client_rate, server_rate,
         client_burst, server_burst;
-    std::random_device rand_dev;
-    std::mt19937 generator(rand_dev());  // Seed random number generator first
     Ptr<DropRateErrorModel> client_drops = CreateObject<DropRateErrorModel>();
     Ptr<DropRateErrorModel> server_drops = CreateObject<DropRateErrorModel>();
     CommandLine cmd;
@@ -4,26 +4,16 @@
 #include "ns3/point-to-point-module.h"
 #include "../helper/quic-network-simulator-helper.h"
 #include "../helper/quic-point-to-point-helper.h"
-#include "droplist-error-model.h"
+#include "../helper/droplist-error-model.h"
 
 using namespace ns3;
 using namespace std;
 
 NS_LOG_COMPONENT_DEFINE("ns3 simulator");
 
-void SetDrops(Ptr<DroplistErrorModel> drop_model, string drops_in) {
-    char *cstr = new char[drops_in.length()+1];
-    strcpy(cstr, drops_in.c_str());
-    char *p = strtok(cstr,",");
-    while (p) {
-        drop_model->SetDrop(stoi(p));
-        p = strtok(NULL,",");
-    }
-    delete[] cstr;
-}
-
 int main(int argc, char *argv[]) {
     std::string delay, bandwidth, queue, client_drops_in, server_drops_in;
+    bool per_flow = false;
     Ptr<DroplistErrorModel> client_drops = CreateObject<DroplistErrorModel>();
     Ptr<DroplistErrorModel> server_drops = CreateObject<DroplistErrorModel>();
     CommandLine cmd;
@@ -33,6 +23,7 @@ int main(int argc, char *argv[]) {
     cmd.AddValue("queue", "queue size of the p2p link (in packets)", queue);
     cmd.AddValue("drops_to_client", "list of packets (towards client) to drop", client_drops_in);
     cmd.AddValue("drops_to_server", "list of packets (towards server) to drop", server_drops_in);
+    cmd.AddValue("per_flow", "count packets per flow (5-tuple), not across all flows", per_flow);
     cmd.Parse (argc, argv);
     
     NS_ABORT_MSG_IF(delay.length() == 0, "Missing parameter: delay");
@@ -40,8 +31,10 @@ int main(int argc, char *argv[]) {
     NS_ABORT_MSG_IF(queue.length() == 0, "Missing parameter: queue");
 
     // Set client and server droplists.
-    SetDrops(client_drops, client_drops_in);
-    SetDrops(server_drops, server_drops_in);
+    client_drops->SetDrops(client_drops_in);
+    server_drops->SetDrops(server_drops_in);
+    client_drops->SetPerFlow(per_flow);
+    server_drops->SetPerFlow(per_flow);
 
     QuicNetworkSimulatorHelper sim;
 
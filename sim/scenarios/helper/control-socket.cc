@@ -0,0 +1,250 @@
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <regex>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "control-socket.h"
+#include "thread-placement.h"
+
+#include "ns3/global-value.h"
+#include "ns3/pointer.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+
+using namespace ns3;
+using namespace std;
+
+static GlobalValue g_controlSocket = GlobalValue("ControlSocket",
+    "The Unix domain socket to control the simulation through, empty to disable",
+    StringValue("/logs/control.sock"), MakeStringChecker());
+
+// How long to wait for the simulator to run a command.
+static const chrono::seconds kCommandTimeout(5);
+// How often the socket thread checks whether it should stop, in ms.
+static const int kPollTimeout = 200;
+
+// ns-3 aborts on times it can't parse, so check them first.
+static bool IsTime(const string &s) {
+    static const regex time("[+-]?([0-9]+\\.?[0-9]*|\\.[0-9]+)([eE][+-]?[0-9]+)?(s|ms|us|ns|ps|fs|min|h|d|y)?");
+    return regex_match(s, time);
+}
+
+static bool WriteAll(int fd, const string &s) {
+    size_t written = 0;
+    while (written < s.size()) {
+        const ssize_t n = send(fd, s.data() + written, s.size() - written, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += n;
+    }
+    return true;
+}
+
+ControlSocket &ControlSocket::Get() {
+    static ControlSocket control;
+    return control;
+}
+
+ControlSocket::ControlSocket() : listen_fd_(-1), stop_(false) {}
+
+void ControlSocket::AddObject(const string &name, Ptr<Object> object) {
+    objects_[name].push_back({object, ""});
+}
+
+void ControlSocket::AddPointer(const string &name, Ptr<Object> owner, const string &attribute) {
+    objects_[name].push_back({owner, attribute});
+}
+
+void ControlSocket::Start() {
+    StringValue path;
+    g_controlSocket.GetValue(path);
+    if (path.Get().empty()) return;
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.Get().size() >= sizeof(addr.sun_path)) {
+        cout << "Control socket path " << path.Get() << " is too long, disabling the control socket" << endl;
+        return;
+    }
+    strncpy(addr.sun_path, path.Get().c_str(), sizeof(addr.sun_path) - 1);
+    // Remove the socket of a previous run.
+    unlink(addr.sun_path);
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0 || bind(listen_fd_, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listen_fd_, 4) < 0) {
+        cout << "Can't serve control socket " << path.Get() << ": " << strerror(errno)
+             << ", disabling the control socket" << endl;
+        if (listen_fd_ >= 0) close(listen_fd_);
+        listen_fd_ = -1;
+        return;
+    }
+    path_ = path.Get();
+    thread_ = thread(&ControlSocket::ServeLoop, this);
+}
+
+void ControlSocket::Stop() {
+    if (listen_fd_ < 0) return;
+    stop_.store(true);
+    if (thread_.joinable()) thread_.join();
+    close(listen_fd_);
+    listen_fd_ = -1;
+    unlink(path_.c_str());
+}
+
+void ControlSocket::ServeLoop() {
+    ThreadPlacement::Get().PlaceCurrentThread(ThreadPlacement::kHelper, "control socket");
+    // One client at a time. Others wait in the backlog.
+    while (!stop_.load()) {
+        pollfd p = {listen_fd_, POLLIN, 0};
+        if (poll(&p, 1, kPollTimeout) <= 0) continue;
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+        ServeClient(fd);
+        close(fd);
+    }
+}
+
+void ControlSocket::ServeClient(int fd) {
+    string buffer;
+    char data[4096];
+    while (!stop_.load()) {
+        pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, kPollTimeout) <= 0) continue;
+        const ssize_t n = read(fd, data, sizeof(data));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        buffer.append(data, n);
+        size_t end;
+        while ((end = buffer.find('\n')) != string::npos) {
+            const string command = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            if (command.find_first_not_of(" \t\r") == string::npos) continue;
+            if (!WriteAll(fd, Submit(command) + "\n")) return;
+        }
+    }
+}
+
+string ControlSocket::Submit(const string &command) {
+    Reply reply = make_shared<promise<string>>();
+    future<string> result = reply->get_future();
+    Simulator::ScheduleWithContext(Simulator::NO_CONTEXT, Seconds(0), &ControlSocket::ExecuteAndReply, this, command, reply);
+    if (result.wait_for(kCommandTimeout) != future_status::ready) return "error the simulation is not running";
+    return result.get();
+}
+
+void ControlSocket::ExecuteAndReply(string command, Reply reply) {
+    reply->set_value(Execute(command));
+}
+
+string ControlSocket::Execute(const string &command) {
+    istringstream in(command);
+    vector<string> args;
+    string arg;
+    while (in >> arg) args.push_back(arg);
+
+    if (args.size() == 1 && args[0] == "list") return DoList();
+    if (args.size() == 3 && args[0] == "get") return DoGet(args[1], args[2]);
+    if (args.size() == 4 && args[0] == "set") return DoSet(args[1], args[2], args[3], "");
+    if (args.size() == 6 && args[0] == "set" && args[4] == "at") return DoSet(args[1], args[2], args[3], args[5]);
+    return "error usage: list | get <object> <attribute> | set <object> <attribute> <value> [at <time>]";
+}
+
+vector<Ptr<Object>> ControlSocket::Resolve(const string &name, string &error) const {
+    vector<Ptr<Object>> objects;
+    auto it = objects_.find(name);
+    if (it == objects_.end()) {
+        error = "error no object " + name;
+        return objects;
+    }
+    for (const Target &target : it->second) {
+        Ptr<Object> object = target.object;
+        if (!target.pointer.empty()) {
+            PointerValue pointer;
+            object->GetAttribute(target.pointer, pointer);
+            object = pointer.Get<Object>();
+        }
+        if (!object) {
+            error = "error " + name + " is not set";
+            return vector<Ptr<Object>>();
+        }
+        objects.push_back(object);
+    }
+    return objects;
+}
+
+string ControlSocket::DoList() {
+    ostringstream out;
+    for (const auto &entry : objects_) {
+        string error;
+        vector<Ptr<Object>> objects = Resolve(entry.first, error);
+        for (Ptr<Object> object : objects) {
+            TypeId tid = object->GetInstanceTypeId();
+            out << entry.first << ": " << tid.GetName();
+            // The settable attributes, including the inherited ones.
+            for (TypeId t = tid;; t = t.GetParent()) {
+                for (size_t i = 0; i < t.GetAttributeN(); i++) {
+                    const TypeId::AttributeInformation info = t.GetAttribute(i);
+                    if (!(info.flags & TypeId::ATTR_SET) || !(info.flags & TypeId::ATTR_GET)) continue;
+                    StringValue value;
+                    if (object->GetAttributeFailSafe(info.name, value)) out << " " << info.name << "=" << value.Get();
+                }
+                if (t.GetParent() == t) break;
+            }
+            out << "\n";
+        }
+        if (objects.empty()) out << entry.first << ": (not set)\n";
+    }
+    out << "ok";
+    return out.str();
+}
+
+string ControlSocket::DoGet(const string &name, const string &attribute) {
+    string error;
+    vector<Ptr<Object>> objects = Resolve(name, error);
+    if (objects.empty()) return error;
+    string result = "ok";
+    for (Ptr<Object> object : objects) {
+        StringValue value;
+        if (!object->GetAttributeFailSafe(attribute, value)) return "error " + name + " has no attribute " + attribute;
+        result += " " + value.Get();
+    }
+    return result;
+}
+
+string ControlSocket::DoSet(const string &name, const string &attribute, const string &value, const string &at) {
+    string error;
+    vector<Ptr<Object>> objects = Resolve(name, error);
+    if (objects.empty()) return error;
+    // Check the value now, so that a change at a later time can't fail.
+    for (Ptr<Object> object : objects) {
+        TypeId::AttributeInformation info;
+        if (!object->GetInstanceTypeId().LookupAttributeByName(attribute, &info))
+            return "error " + name + " has no attribute " + attribute;
+        if (!(info.flags & TypeId::ATTR_SET)) return "error " + attribute + " can't be changed";
+        if (info.checker->GetValueTypeName() == "ns3::TimeValue" && !IsTime(value))
+            return "error invalid value " + value;
+        if (!info.checker->CreateValidValue(StringValue(value))) return "error invalid value " + value;
+    }
+    if (at.empty()) {
+        Apply(name, objects, attribute, value);
+        return "ok at " + to_string(Simulator::Now().GetSeconds()) + "s";
+    }
+    if (!IsTime(at)) return "error invalid time " + at;
+    const Time when(at);
+    if (when < Simulator::Now())
+        return "error " + at + " is in the past, it is " + to_string(Simulator::Now().GetSeconds()) + "s";
+    Simulator::Schedule(when - Simulator::Now(), &ControlSocket::Apply, this, name, objects, attribute, value);
+    return "ok scheduled at " + to_string(when.GetSeconds()) + "s";
+}
+
+void ControlSocket::Apply(string name, vector<Ptr<Object>> objects, string attribute, string value) {
+    for (Ptr<Object> object : objects) object->SetAttribute(attribute, StringValue(value));
+    cout << "Control: set " << name << " " << attribute << "=" << value << " at "
+         << Simulator::Now().GetSeconds() << "s" << endl;
+}
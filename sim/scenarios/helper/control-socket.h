@@ -0,0 +1,84 @@
+#ifndef CONTROL_SOCKET_H
+#define CONTROL_SOCKET_H
+
+#include <atomic>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+using namespace ns3;
+
+// ControlSocket serves a Unix domain socket (ControlSocket,
+// /logs/control.sock by default, empty to disable) to read and change the
+// parameters of the simulation while it runs, one command per line:
+//   list                                          the objects and their attributes
+//   get <object> <attribute>
+//   set <object> <attribute> <value> [at <time>]
+// The objects are registered by the helpers (e.g. to_client.link, channel,
+// to_server.queue, error_model), attributes are their ns-3 attributes, and
+// values are written as on the command line (e.g. 5Mbps, 20ms, 50p).
+// Every command runs on the simulator thread. A set takes effect at the
+// simulated time it is processed, or with `at`, exactly at the given
+// simulated time. Every command is answered with a line starting with "ok"
+// or "error"; list first prints one line per object. See the sim-control tool.
+class ControlSocket {
+public:
+    static ControlSocket &Get();
+
+    // Make object reachable as name. Several objects can share a name: a set
+    // changes all of them at the same time.
+    void AddObject(const std::string &name, Ptr<Object> object);
+    // Make the object that the pointer attribute of owner refers to
+    // reachable as name, e.g. the ReceiveErrorModel of a device. It is
+    // looked up for every command, so it can be set after this call.
+    void AddPointer(const std::string &name, Ptr<Object> owner, const std::string &attribute);
+
+    // Run a command, e.g. from a scenario's timeline, and return the reply.
+    // Call on the simulator thread, or while setting up the simulation.
+    std::string Execute(const std::string &command);
+
+    // Start serving. Call before Simulator::Run().
+    void Start();
+    // Close the socket. Called when the simulation ends.
+    void Stop();
+
+private:
+    ControlSocket();
+    ControlSocket(const ControlSocket &) = delete;
+    ControlSocket &operator=(const ControlSocket &) = delete;
+
+    struct Target {
+        Ptr<Object> object;
+        std::string pointer; // if set, the pointer attribute of object
+    };
+    typedef std::shared_ptr<std::promise<std::string>> Reply;
+
+    // Socket thread.
+    void ServeLoop();
+    void ServeClient(int fd);
+    std::string Submit(const std::string &command);
+
+    // Simulator thread.
+    void ExecuteAndReply(std::string command, Reply reply);
+    std::string DoList();
+    std::string DoGet(const std::string &name, const std::string &attribute);
+    std::string DoSet(const std::string &name, const std::string &attribute, const std::string &value,
+                      const std::string &at);
+    void Apply(std::string name, std::vector<Ptr<Object>> objects, std::string attribute, std::string value);
+    // The objects registered as name, or an empty vector (and error).
+    std::vector<Ptr<Object>> Resolve(const std::string &name, std::string &error) const;
+
+    std::map<std::string, std::vector<Target>> objects_;
+    std::string path_;
+    int listen_fd_;
+    std::atomic<bool> stop_;
+    std::thread thread_;
+};
+
+#endif /* CONTROL_SOCKET_H */
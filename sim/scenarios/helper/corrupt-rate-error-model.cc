@@ -1,10 +1,11 @@
-#include <iomanip>
-
 #include <cstdint>
 #include <vector>
 
 #include "corrupt-rate-error-model.h"
-#include "../helper/quic-packet.h"
+#include "event-log.h"
+#include "quic-packet.h"
+
+#include "ns3/integer.h"
 
 using namespace std;
 
@@ -14,15 +15,22 @@ TypeId CorruptRateErrorModel::GetTypeId(void) {
     static TypeId tid = TypeId("CorruptRateErrorModel")
         .SetParent<ErrorModel>()
         .AddConstructor<CorruptRateErrorModel>()
+        .AddAttribute("CorruptRate",
+                      "The percentage of packets to corrupt",
+                      IntegerValue(0),
+                      MakeIntegerAccessor(&CorruptRateErrorModel::rate),
+                      MakeIntegerChecker<int>(0, 100))
+        .AddAttribute("MaxCorruptBurst",
+                      "The maximum number of packets to corrupt in a row",
+                      IntegerValue(INT_MAX),
+                      MakeIntegerAccessor(&CorruptRateErrorModel::burst),
+                      MakeIntegerChecker<int>(0))
         ;
     return tid;
 }
 
 CorruptRateErrorModel::CorruptRateErrorModel()
-    : rate(0), distr(0, 99), burst(INT_MAX), corrupted_in_a_row(0), corrupted(0), forwarded(0) {
-    std::random_device rd;
-    rng = new std::mt19937(rd());
-}
+    : rate(0), rng("CorruptRateErrorModel"), burst(INT_MAX), corrupted_in_a_row(0), corrupted(0), forwarded(0) {}
 
 void CorruptRateErrorModel::DoReset(void) {
     corrupted_in_a_row = 0;
@@ -34,6 +42,7 @@ bool CorruptRateErrorModel::DoCorrupt(Ptr<Packet> p) {
     if(!IsUDPPacket(p)) return false;
 
     QuicPacket qp = QuicPacket(p);
+    if (!qp.IsValid()) return false;
 
     bool shouldCorrupt = false;
     if (qp.IsVersionNegotiationPacket()) {
@@ -44,10 +53,13 @@ bool CorruptRateErrorModel::DoCorrupt(Ptr<Packet> p) {
         // offered.
         corrupted_in_a_row = 0;
         shouldCorrupt = false;
+    } else if (qp.GetUdpPayloadSize() == 0) {
+        // There is nothing to corrupt.
+        shouldCorrupt = false;
     } else if (corrupted_in_a_row >= burst) {
         corrupted_in_a_row = 0;
         shouldCorrupt = false;
-    } else if (distr(*rng) < rate) {
+    } else if ((int)rng.Below(100) < rate) {
         corrupted_in_a_row++;
         shouldCorrupt = true;
     } else {
@@ -59,43 +71,37 @@ bool CorruptRateErrorModel::DoCorrupt(Ptr<Packet> p) {
     uint8_t old_n = 0;
     uint8_t new_n = 0;
     if (shouldCorrupt) {
-        cout << "Corrupting ";
         corrupted++;
+        counters.corrupted_packets.Add();
+        counters.corrupted_bytes.Add(qp.GetUdpPayloadSize());
 
         // Corrupt a byte in the 50 bytes of the UDP payload.
         // This way, we will frequently hit the QUIC header.
-        std::uniform_int_distribution<> d(0, min(uint32_t(50), p->GetSize() - 1));
-        pos = d(*rng);
-        vector<uint8_t> & payload = qp.GetUdpPayload();
+        pos = rng.Below(min(uint32_t(50), qp.GetUdpPayloadPrefixSize() - 1) + 1);
         // Replace the byte at position pos with a random value.
         while (true) {
-            uint8_t n = std::uniform_int_distribution<>(0, 255)(*rng);
-            if (payload[pos] == n)
+            uint8_t n = rng.Below(256);
+            if (qp.GetPayloadByte(pos) == n)
                 continue;
-            old_n = payload[pos];
-            payload[pos] = n;
-            new_n = payload[pos];
+            old_n = qp.GetPayloadByte(pos);
+            qp.SetPayloadByte(pos, n);
+            new_n = n;
             break;
         }
     } else {
-        cout << "Forwarding ";
         forwarded++;
     }
-    qp.ReassemblePacket();
-
-    cout << qp.GetUdpPayload().size() << " bytes "
-         << qp.GetIpv4Header().GetSource() << ":"
-         << qp.GetUdpHeader().GetSourcePort() << " -> "
-         << qp.GetIpv4Header().GetDestination() << ":"
-         << qp.GetUdpHeader().GetDestinationPort();
-    if (pos != 0)
-        cout <<  " offset " << pos << " 0x" << std::hex
-             << (unsigned int)old_n << " -> 0x" << (unsigned int)new_n
-             << std::dec;
-    cout << ", corrupted "
-         << corrupted << "/" << corrupted + forwarded << " (" << fixed
-         << setprecision(1) << (double)corrupted / (corrupted + forwarded) * 100
-         << "%)" << endl;
+    qp.Commit();
+
+    EventLog &log = EventLog::Get();
+    if (log.IsEnabled(EventLog::kPackets)) {
+        EventRecord r = EventLog::PacketRecord(shouldCorrupt ? kEventCorrupt : kEventCorruptForward, qp);
+        r.arg[0] = corrupted;
+        r.arg[1] = corrupted + forwarded;
+        r.arg[2] = pos;
+        r.arg16 = old_n << 8 | new_n;
+        log.Log(r);
+    }
 
     return shouldCorrupt;
 }
@@ -107,3 +113,7 @@ void CorruptRateErrorModel::SetCorruptRate(int rate_in) {
 void CorruptRateErrorModel::SetMaxCorruptBurst(int burst_in) {
     burst = burst_in;
 }
+
+void CorruptRateErrorModel::SetCounters(const DirectionCounters &counters_in) {
+    counters = counters_in;
+}
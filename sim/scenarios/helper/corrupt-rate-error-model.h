@@ -2,8 +2,9 @@
 #define CORRUPTRATE_ERROR_MODEL_H
 
 #include <set>
-#include <random>
 #include "ns3/error-model.h"
+#include "counters.h"
+#include "random-source.h"
 
 using namespace ns3;
 
@@ -15,15 +16,16 @@ class CorruptRateErrorModel : public RateErrorModel {
     CorruptRateErrorModel();
     void SetCorruptRate(int perc);
     void SetMaxCorruptBurst(int burst);
+    void SetCounters(const DirectionCounters &counters);
     
  private:
     int rate;
-    std::mt19937 *rng;
-    std::uniform_int_distribution<> distr;
+    RandomStream rng;
     int burst;
     int corrupted_in_a_row;
     int corrupted;
     int forwarded;
+    DirectionCounters counters;
 
     bool DoCorrupt (Ptr<Packet> p);
     void DoReset(void);
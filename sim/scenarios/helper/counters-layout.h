@@ -0,0 +1,60 @@
+#ifndef COUNTERS_LAYOUT_H
+#define COUNTERS_LAYOUT_H
+
+// The layout of the shared-memory counters file. This header doesn't depend
+// on ns-3, it is shared with the counters-read tool (sim/tools).
+//
+// The file is a CountersFileHeader followed by kMaxCounterEntries entries.
+// Entries are allocated in order and never freed, so a reader only needs to
+// look at the first num_entries entries. A histogram takes one entry for its
+// name and total count, followed by kHistogramBuckets bucket entries.
+
+#include <cstdint>
+
+static const char kCountersMagic[8] = {'Q', 'N', 'S', 'C', 'N', 'T', 'R', 'S'};
+static const uint32_t kCountersVersion = 1;
+static const uint32_t kMaxCounterEntries = 1024;
+// Bucket i counts values v with 2^(i-1) <= v < 2^i, bucket 0 counts zeros.
+// The last bucket also counts everything larger.
+static const uint32_t kHistogramBuckets = 32;
+
+// Returns the upper bound of the histogram bucket that contains the
+// q-quantile of count samples, where bucket(i) is the number of samples in
+// bucket i: 1 for bucket 0, 2^i for bucket i.
+template <typename BucketCount>
+static inline uint64_t HistogramQuantile(uint64_t count, double q, BucketCount bucket) {
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < kHistogramBuckets; i++) {
+        seen += bucket(i);
+        if (seen >= q * count) return 1ull << i;
+    }
+    return 1ull << (kHistogramBuckets - 1);
+}
+
+enum CounterKind : uint8_t {
+    kCounterMonotonic = 1, // only ever increases
+    kCounterGauge = 2,     // current value
+    kCounterHistogram = 3, // value: number of samples; followed by the buckets
+    kCounterBucket = 4,
+};
+
+struct CountersFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    // Written with release semantics after an entry is fully initialized.
+    uint32_t num_entries;
+    uint32_t pad;
+    uint64_t start_time_ns; // CLOCK_REALTIME, when the simulator started
+};
+
+struct CounterEntry {
+    char name[48];
+    uint8_t kind; // CounterKind
+    uint8_t pad[7];
+    uint64_t value; // accessed atomically
+};
+
+static_assert(sizeof(CounterEntry) == 64, "CounterEntry should fill a cache line");
+
+#endif /* COUNTERS_LAYOUT_H */
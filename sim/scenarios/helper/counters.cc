@@ -0,0 +1,137 @@
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "counters.h"
+
+#include "ns3/global-value.h"
+#include "ns3/string.h"
+
+using namespace ns3;
+using namespace std;
+
+static GlobalValue g_countersFile = GlobalValue("CountersFile",
+    "Shared-memory file that the live counters are exported to (empty to disable)",
+    StringValue("/logs/counters.bin"), MakeStringChecker());
+
+void Histogram::Record(uint64_t v) {
+    if (!buckets_) return;
+    uint32_t bucket = v == 0 ? 0 : 64 - __builtin_clzll(v);
+    if (bucket >= kHistogramBuckets) bucket = kHistogramBuckets - 1;
+    Counter(&buckets_[bucket].value).Add();
+    count_.Add();
+}
+
+CounterRegistry &CounterRegistry::Get() {
+    static CounterRegistry registry;
+    return registry;
+}
+
+// Map the counters file, or return MAP_FAILED.
+static void *MapCountersFile(const string &filename, size_t size) {
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, size) < 0) {
+        cout << "Can't create counters file " << filename << ": " << strerror(errno)
+             << ", not exporting counters" << endl;
+        if (fd >= 0) close(fd);
+        return MAP_FAILED;
+    }
+    void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        cout << "Can't map counters file " << filename << ": " << strerror(errno)
+             << ", not exporting counters" << endl;
+    return p;
+}
+
+CounterRegistry::CounterRegistry() : header_(nullptr), entries_(nullptr) {
+    StringValue filename;
+    g_countersFile.GetValue(filename);
+
+    const size_t size = sizeof(CountersFileHeader) + kMaxCounterEntries * sizeof(CounterEntry);
+    void *p = filename.Get().empty() ? MAP_FAILED : MapCountersFile(filename.Get(), size);
+    // The simulator reads some counters itself (see LossReport), so keep
+    // them in memory if they can't be exported.
+    if (p == MAP_FAILED) p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        cout << "Can't allocate counters: " << strerror(errno) << ", disabling counters" << endl;
+        return;
+    }
+    // ftruncate (or mmap) zero-filled the memory.
+    header_ = static_cast<CountersFileHeader *>(p);
+    entries_ = reinterpret_cast<CounterEntry *>(header_ + 1);
+    header_->version = kCountersVersion;
+    header_->entry_size = sizeof(CounterEntry);
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    header_->start_time_ns = now.tv_sec * 1000000000ull + now.tv_nsec;
+    // Readers check the magic last.
+    atomic_thread_fence(memory_order_release);
+    memcpy(header_->magic, kCountersMagic, sizeof(header_->magic));
+}
+
+CounterEntry *CounterRegistry::Allocate(const string &name, CounterKind kind, uint32_t n) {
+    if (!header_) return nullptr;
+    const uint32_t first = header_->num_entries;
+    if (first + n > kMaxCounterEntries) {
+        cout << "Out of counter entries, not exporting " << name << endl;
+        return nullptr;
+    }
+    CounterEntry *e = &entries_[first];
+    strncpy(e->name, name.c_str(), sizeof(e->name) - 1);
+    e->kind = kind;
+    for (uint32_t i = 1; i < n; i++) entries_[first + i].kind = kCounterBucket;
+    // Publish the entries only after they are initialized.
+    reinterpret_cast<atomic<uint32_t> *>(&header_->num_entries)->store(first + n, memory_order_release);
+    return e;
+}
+
+Counter CounterRegistry::RegisterCounter(const string &name) {
+    lock_guard<mutex> lock(mutex_);
+    CounterEntry *e = Allocate(name, kCounterMonotonic, 1);
+    return e ? Counter(&e->value) : Counter();
+}
+
+Counter CounterRegistry::RegisterGauge(const string &name) {
+    lock_guard<mutex> lock(mutex_);
+    CounterEntry *e = Allocate(name, kCounterGauge, 1);
+    return e ? Counter(&e->value) : Counter();
+}
+
+Histogram CounterRegistry::RegisterHistogram(const string &name) {
+    lock_guard<mutex> lock(mutex_);
+    CounterEntry *e = Allocate(name, kCounterHistogram, 1 + kHistogramBuckets);
+    return e ? Histogram(&e->value, e + 1) : Histogram();
+}
+
+DirectionCounters &CounterRegistry::GetDirection(const string &direction) {
+    {
+        lock_guard<mutex> lock(mutex_);
+        auto it = directions_.find(direction);
+        if (it != directions_.end()) return it->second;
+    }
+    DirectionCounters c;
+    const string p = direction + ".";
+    c.forwarded_packets = RegisterCounter(p + "forwarded.packets");
+    c.forwarded_bytes = RegisterCounter(p + "forwarded.bytes");
+    c.dropped_packets = RegisterCounter(p + "dropped.packets");
+    c.dropped_bytes = RegisterCounter(p + "dropped.bytes");
+    c.corrupted_packets = RegisterCounter(p + "corrupted.packets");
+    c.corrupted_bytes = RegisterCounter(p + "corrupted.bytes");
+    c.rebound_packets = RegisterCounter(p + "rebound.packets");
+    c.rebound_bytes = RegisterCounter(p + "rebound.bytes");
+    c.queued_packets = RegisterCounter(p + "queued.packets");
+    c.queued_bytes = RegisterCounter(p + "queued.bytes");
+    c.queue_dropped_packets = RegisterCounter(p + "queue_dropped.packets");
+    c.device_queue_dropped_packets = RegisterCounter(p + "device_queue_dropped.packets");
+    c.backlog_packets = RegisterGauge(p + "backlog.packets");
+    c.backlog_bytes = RegisterGauge(p + "backlog.bytes");
+    c.link_rate = RegisterGauge(p + "link_rate.bps");
+    c.sojourn_time = RegisterHistogram(p + "sojourn_time.us");
+    lock_guard<mutex> lock(mutex_);
+    return directions_.emplace(direction, c).first->second;
+}
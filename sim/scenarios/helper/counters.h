@@ -0,0 +1,88 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "counters-layout.h"
+
+// A Counter is a 64 bit value in the shared-memory counters file.
+// Updates are single atomic instructions, and never do any I/O: readers map
+// the same file and poll it (see the counters-read tool).
+// A default-constructed Counter discards all updates.
+class Counter {
+public:
+    Counter() : v_(nullptr) {}
+    explicit Counter(uint64_t *v) : v_(reinterpret_cast<std::atomic<uint64_t> *>(v)) {}
+
+    void Add(uint64_t n = 1) {
+        if (v_) v_->fetch_add(n, std::memory_order_relaxed);
+    }
+    void Set(uint64_t n) {
+        if (v_) v_->store(n, std::memory_order_relaxed);
+    }
+    uint64_t Get() const { return v_ ? v_->load(std::memory_order_relaxed) : 0; }
+
+private:
+    std::atomic<uint64_t> *v_;
+};
+
+// A Histogram counts samples in power-of-two buckets.
+class Histogram {
+public:
+    Histogram() : count_(nullptr), buckets_(nullptr) {}
+    Histogram(uint64_t *count, CounterEntry *buckets) : count_(count), buckets_(buckets) {}
+
+    void Record(uint64_t v);
+
+private:
+    Counter count_;
+    CounterEntry *buckets_;
+};
+
+// The counters of one direction of the link ("to_client" or "to_server").
+struct DirectionCounters {
+    Counter forwarded_packets, forwarded_bytes;
+    Counter dropped_packets, dropped_bytes;
+    Counter corrupted_packets, corrupted_bytes;
+    Counter rebound_packets, rebound_bytes;
+    Counter queued_packets, queued_bytes;
+    Counter queue_dropped_packets;
+    Counter device_queue_dropped_packets; // the link device's own queue
+    Counter backlog_packets, backlog_bytes; // gauges
+    Counter link_rate;                      // gauge, in bit/s
+    Histogram sojourn_time;                 // in us
+};
+
+// CounterRegistry owns the counters file (CountersFile, /logs/counters.bin by
+// default). Registering counters takes a lock and is meant to happen while
+// setting up the simulation. If the file can't be created (or CountersFile
+// is empty), the counters are kept in memory only.
+class CounterRegistry {
+public:
+    static CounterRegistry &Get();
+
+    Counter RegisterCounter(const std::string &name);
+    Counter RegisterGauge(const std::string &name);
+    Histogram RegisterHistogram(const std::string &name);
+
+    // Registers the counters of a direction on first use.
+    DirectionCounters &GetDirection(const std::string &direction);
+
+private:
+    CounterRegistry();
+    CounterRegistry(const CounterRegistry &) = delete;
+    CounterRegistry &operator=(const CounterRegistry &) = delete;
+
+    CounterEntry *Allocate(const std::string &name, CounterKind kind, uint32_t n);
+
+    std::mutex mutex_;
+    CountersFileHeader *header_;
+    CounterEntry *entries_;
+    std::map<std::string, DirectionCounters> directions_;
+};
+
+#endif /* COUNTERS_H */
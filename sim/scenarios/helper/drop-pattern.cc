@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <sstream>
+
+#include "drop-pattern.h"
+
+#include "ns3/abort.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
+
+using namespace ns3;
+using namespace std;
+
+const uint64_t DropPattern::kMaxBitmap;
+
+// Parse a packet number, the whole of s.
+static uint64_t ParseNumber(const string &s, const string &item) {
+    NS_ABORT_MSG_IF(s.empty() || s.find_first_not_of("0123456789") != string::npos,
+                    "Invalid packet number in droplist: " << item);
+    const uint64_t n = stoull(s);
+    NS_ABORT_MSG_IF(n == 0, "Invalid packet number in droplist: " << item << " (packets are numbered from 1)");
+    return n;
+}
+
+void DropPattern::Add(const string &list) {
+    stringstream ss(list);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (item.empty()) continue;
+        string range = item;
+        uint64_t every = 1;
+        const size_t slash = item.find('/');
+        if (slash != string::npos) {
+            range = item.substr(0, slash);
+            every = ParseNumber(item.substr(slash + 1), item);
+        }
+        const size_t dash = range.find('-');
+        if (dash == string::npos) {
+            NS_ABORT_MSG_IF(slash != string::npos, "Invalid droplist item: " << item << " (expected <first>-[<last>]/<k>)");
+            const uint64_t n = ParseNumber(range, item);
+            items_.push_back({n, n, 1});
+            continue;
+        }
+        const uint64_t first = ParseNumber(range.substr(0, dash), item);
+        const string last = range.substr(dash + 1);
+        items_.push_back({first, last.empty() ? kOpen : ParseNumber(last, item), every});
+        NS_ABORT_MSG_IF(items_.back().last < first, "Invalid droplist item: " << item << " (empty range)");
+    }
+    Build();
+}
+
+void DropPattern::Add(uint64_t first, uint64_t last, uint64_t every) {
+    items_.push_back({first, last, every});
+    Build();
+}
+
+void DropPattern::Build() {
+    size_ = 0;
+    for (const Item &item : items_) {
+        if (item.last != kOpen) size_ = max(size_, min(item.last + 1, kMaxBitmap));
+    }
+    bits_.assign((size_ + 63) / 64, 0);
+    rules_.clear();
+    for (const Item &item : items_) {
+        uint64_t n = item.first;
+        bool more = true; // n is in the item
+        while (more && n < size_) {
+            bits_[n >> 6] |= uint64_t(1) << (n & 63);
+            more = item.last - n >= item.every;
+            n += item.every;
+        }
+        if (more) rules_.push_back({n, item.last, item.every});
+    }
+}
+
+uint64_t PacketNumbering::Next(const QuicPacket &qp) {
+    if (!per_flow_) return Next();
+    // All flows are UDP, the 5-tuple is the addresses and ports.
+    uint8_t key[2 * 16 + 2 * 2] = {0};
+    const Address src = qp.GetSource();
+    const Address dst = qp.GetDestination();
+    if (qp.IsIpv6()) {
+        Ipv6Address::ConvertFrom(src).Serialize(key);
+        Ipv6Address::ConvertFrom(dst).Serialize(key + 16);
+    } else {
+        Ipv4Address::ConvertFrom(src).Serialize(key);
+        Ipv4Address::ConvertFrom(dst).Serialize(key + 16);
+    }
+    const uint16_t ports[2] = {qp.GetSourcePort(), qp.GetDestinationPort()};
+    copy((const uint8_t *)ports, (const uint8_t *)ports + sizeof(ports), key + 32);
+    return ++flows_[string((const char *)key, sizeof(key))];
+}
+
+void PacketNumbering::Reset() {
+    packet_num_ = 0;
+    flows_.clear();
+}
@@ -0,0 +1,77 @@
+#ifndef DROP_PATTERN_H
+#define DROP_PATTERN_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "quic-packet.h"
+
+// A DropPattern is a set of packet numbers, written as a comma-separated
+// list of
+//   <n>             packet n
+//   <a>-<b>         packets a to b
+//   <a>-            packet a and all later packets
+//   <a>-<b>/<k>     every k-th packet from a to b (a, a + k, ...)
+//   <a>-/<k>        every k-th packet from a on
+// e.g. 1-50,100,200-300/10. Packet numbers start at 1.
+//
+// Packets up to the largest bounded number in the pattern are kept in a
+// bitmap, so Contains() is a bit test for them. Only the parts of the
+// pattern beyond the bitmap (open ranges, and ranges above kMaxBitmap) are
+// tested one by one.
+class DropPattern {
+public:
+    DropPattern() : size_(0) {}
+
+    // Add the packets in list. Aborts on errors.
+    void Add(const std::string &list);
+    void Add(uint64_t first, uint64_t last, uint64_t every);
+    bool IsEmpty() const { return items_.empty(); }
+
+    bool Contains(uint64_t n) const {
+        if (n < size_) return (bits_[n >> 6] >> (n & 63)) & 1;
+        for (const Item &r : rules_) {
+            if (n >= r.first && n <= r.last && (n - r.first) % r.every == 0) return true;
+        }
+        return false;
+    }
+
+private:
+    static const uint64_t kOpen = UINT64_MAX;
+    static const uint64_t kMaxBitmap = 1 << 24; // 2 MB
+
+    struct Item {
+        uint64_t first, last, every;
+    };
+    void Build();
+
+    std::vector<Item> items_;
+    uint64_t size_;              // the bitmap covers packets below size_
+    std::vector<uint64_t> bits_;
+    std::vector<Item> rules_;    // the parts of items_ from size_ on
+};
+
+// PacketNumbering numbers packets for a DropPattern: either across all
+// packets, or per flow (5-tuple), so that the pattern applies to each flow
+// separately when there is cross traffic.
+class PacketNumbering {
+public:
+    PacketNumbering() : per_flow_(false), packet_num_(0) {}
+
+    void SetPerFlow(bool per_flow) { per_flow_ = per_flow; }
+    bool IsPerFlow() const { return per_flow_; }
+    // The number of the next packet, across all flows.
+    uint64_t Next() { return ++packet_num_; }
+    // The number of qp, in its flow if counting per flow.
+    uint64_t Next(const QuicPacket &qp);
+    void Reset();
+
+private:
+    bool per_flow_;
+    uint64_t packet_num_;
+    std::unordered_map<std::string, uint64_t> flows_;
+};
+
+#endif /* DROP_PATTERN_H */
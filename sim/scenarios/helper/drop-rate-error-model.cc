@@ -0,0 +1,79 @@
+#include "event-log.h"
+#include "quic-packet.h"
+#include "drop-rate-error-model.h"
+
+#include "ns3/integer.h"
+
+using namespace std;
+
+NS_OBJECT_ENSURE_REGISTERED(DropRateErrorModel);
+
+TypeId DropRateErrorModel::GetTypeId(void) {
+    static TypeId tid = TypeId("DropRateErrorModel")
+        .SetParent<ErrorModel>()
+        .AddConstructor<DropRateErrorModel>()
+        .AddAttribute("DropRate",
+                      "The percentage of packets to drop",
+                      IntegerValue(0),
+                      MakeIntegerAccessor(&DropRateErrorModel::rate),
+                      MakeIntegerChecker<int>(0, 100))
+        .AddAttribute("MaxDropBurst",
+                      "The maximum number of packets to drop in a row",
+                      IntegerValue(INT_MAX),
+                      MakeIntegerAccessor(&DropRateErrorModel::burst),
+                      MakeIntegerChecker<int>(0))
+        ;
+    return tid;
+}
+
+DropRateErrorModel::DropRateErrorModel()
+    : rate(0), rng("DropRateErrorModel"), burst(INT_MAX), dropped_in_a_row(0), dropped(0), forwarded(0)
+{
+}
+
+void DropRateErrorModel::DoReset(void) {
+    dropped_in_a_row = 0;
+    dropped = 0;
+    forwarded = 0;
+}
+ 
+bool DropRateErrorModel::DoCorrupt(Ptr<Packet> p) {
+    if(!IsUDPPacket(p)) return false;
+
+    QuicPacket qp = QuicPacket(p);
+    if (!qp.IsValid()) return false;
+
+    bool shouldDrop = false;
+    if (dropped_in_a_row >= burst) {
+        dropped_in_a_row = 0;
+        shouldDrop = false;
+    } else if ((int)rng.Below(100) < rate) {
+        dropped_in_a_row++;
+        shouldDrop = true;
+    } else {
+        dropped_in_a_row = 0;
+        shouldDrop = false;
+    }
+
+    if (shouldDrop)
+        dropped++;
+    else
+        forwarded++;
+    EventLog &log = EventLog::Get();
+    if (log.IsEnabled(EventLog::kPackets)) {
+        EventRecord r = EventLog::PacketRecord(shouldDrop ? kEventDropRateDrop : kEventDropRateForward, qp);
+        r.arg[0] = dropped;
+        r.arg[1] = dropped + forwarded;
+        log.Log(r);
+    }
+
+    return shouldDrop;
+}
+
+void DropRateErrorModel::SetDropRate(int rate_in) {
+    rate = rate_in;
+}
+
+void DropRateErrorModel::SetMaxDropBurst(int burst_in) {
+    burst = burst_in;
+}
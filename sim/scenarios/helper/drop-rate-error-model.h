@@ -2,8 +2,8 @@
 #define DROPRATE_ERROR_MODEL_H
 
 #include <set>
-#include <random>
 #include "ns3/error-model.h"
+#include "random-source.h"
 
 using namespace ns3;
 
@@ -18,8 +18,7 @@ class DropRateErrorModel : public ErrorModel {
     
  private:
     int rate;
-    std::mt19937 *rng;
-    std::uniform_int_distribution<> distr;
+    RandomStream rng;
     int next_rate;
     int burst;
     int dropped_in_a_row;
@@ -0,0 +1,45 @@
+#include "event-log.h"
+#include "quic-packet.h"
+#include "droplist-error-model.h"
+
+using namespace std;
+
+NS_OBJECT_ENSURE_REGISTERED(DroplistErrorModel);
+ 
+TypeId DroplistErrorModel::GetTypeId(void) {
+    static TypeId tid = TypeId("DroplistErrorModel")
+        .SetParent<ErrorModel>()
+        .AddConstructor<DroplistErrorModel>()
+        ;
+    return tid;
+}
+ 
+DroplistErrorModel::DroplistErrorModel() { }
+
+void DroplistErrorModel::DoReset(void) { }
+ 
+bool DroplistErrorModel::DoCorrupt(Ptr<Packet> p) {
+    if(!IsUDPPacket(p)) return false;
+    // Across all flows, only the dropped packets need to be parsed.
+    uint64_t packet_num = 0;
+    if (!numbering.IsPerFlow() && !drops.Contains(packet_num = numbering.Next())) return false;
+    
+    QuicPacket qp = QuicPacket(p);
+    if (!qp.IsValid()) return false;
+    if (numbering.IsPerFlow() && !drops.Contains(packet_num = numbering.Next(qp))) return false;
+    EventLog &log = EventLog::Get();
+    if (log.IsEnabled(EventLog::kPackets)) {
+        EventRecord r = EventLog::PacketRecord(kEventDroplistDrop, qp);
+        r.arg[0] = packet_num;
+        log.Log(r);
+    }
+    return true;
+}
+
+void DroplistErrorModel::SetDrops(const string &list) {
+    drops.Add(list);
+}
+
+void DroplistErrorModel::SetPerFlow(bool per_flow) {
+    numbering.SetPerFlow(per_flow);
+}
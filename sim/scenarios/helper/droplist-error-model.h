@@ -1,24 +1,28 @@
 #ifndef DROPLIST_ERROR_MODEL_H
 #define DROPLIST_ERROR_MODEL_H
 
-#include <set>
+#include <string>
 #include "ns3/error-model.h"
+#include "drop-pattern.h"
 
 using namespace ns3;
 
 // The DroplistErrorModel drops packets enumerated by the user. This model does
 // a simple packet count and drops the specified packets. Packet numbering
-// starts at 1.
+// starts at 1. Packets are counted across all flows, or per flow.
 
 class DroplistErrorModel : public ErrorModel {
  public:
     static TypeId GetTypeId(void);
     DroplistErrorModel();
-    void SetDrop(int packet_num);
+    // Drop the packets in list, e.g. 1-50,100,200-. See DropPattern.
+    void SetDrops(const std::string &list);
+    // Count packets per flow (5-tuple) instead of across all flows.
+    void SetPerFlow(bool per_flow);
     
  private:
-    std::set<int> drops;
-    int packet_num;
+    DropPattern drops;
+    PacketNumbering numbering;
     bool DoCorrupt (Ptr<Packet> p);
     void DoReset(void);
 };
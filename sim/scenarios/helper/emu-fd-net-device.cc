@@ -0,0 +1,30 @@
+// The ns-3 headers go first: <linux/if_packet.h> defines PACKET_HOST etc.
+// as macros, which clash with NetDevice::PacketType.
+#include "emu-fd-net-device.h"
+
+#include <linux/if_packet.h>
+#include <sys/socket.h>
+
+using namespace ns3;
+
+NS_OBJECT_ENSURE_REGISTERED(EmuFdNetDevice);
+
+TypeId EmuFdNetDevice::GetTypeId(void) {
+    static TypeId tid = TypeId("EmuFdNetDevice")
+        .SetParent<FdNetDevice>()
+        .AddConstructor<EmuFdNetDevice>()
+        ;
+    return tid;
+}
+
+EmuFdNetDevice::EmuFdNetDevice() : kernel_dropped_(0) {}
+
+uint64_t EmuFdNetDevice::GetKernelDrops() {
+    // Reading the statistics resets them.
+    tpacket_stats stats;
+    socklen_t len = sizeof(stats);
+    const int fd = GetFileDescriptor();
+    if (fd >= 0 && getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) == 0)
+        kernel_dropped_ += stats.tp_drops;
+    return kernel_dropped_;
+}
@@ -0,0 +1,26 @@
+#ifndef EMU_FD_NET_DEVICE_H
+#define EMU_FD_NET_DEVICE_H
+
+#include <cstdint>
+
+#include "ns3/fd-net-device.h"
+
+using namespace ns3;
+
+// EmuFdNetDevice is the FdNetDevice that EmuFdNetDeviceHelper creates for
+// eth0 / eth1 (--NetDevice=emu), with access to the kernel's statistics of
+// its raw socket, for the LossReport.
+class EmuFdNetDevice : public FdNetDevice {
+public:
+    static TypeId GetTypeId(void);
+    EmuFdNetDevice();
+
+    // Frames the kernel dropped because the socket's buffer was full, since
+    // the device started (PACKET_STATISTICS).
+    uint64_t GetKernelDrops();
+
+private:
+    uint64_t kernel_dropped_;
+};
+
+#endif /* EMU_FD_NET_DEVICE_H */
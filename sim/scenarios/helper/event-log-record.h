@@ -0,0 +1,101 @@
+#ifndef EVENT_LOG_RECORD_H
+#define EVENT_LOG_RECORD_H
+
+// The on-disk format of the event log. This header doesn't depend on ns-3,
+// it is shared with the event-log-decode tool (sim/tools).
+
+#include <cstdint>
+
+// The log file starts with this header, followed by EventRecords.
+struct EventLogFileHeader {
+    char magic[8];        // kEventLogMagic
+    uint32_t version;     // kEventLogVersion
+    uint32_t record_size; // sizeof(EventRecord)
+};
+
+static const char kEventLogMagic[8] = {'Q', 'N', 'S', 'E', 'V', 'L', 'O', 'G'};
+static const uint32_t kEventLogVersion = 1;
+
+enum EventType : uint8_t {
+    // Per-packet events. The record holds the flow and the UDP payload size.
+    kEventDropRateForward = 1,   // arg[0]: dropped, arg[1]: total
+    kEventDropRateDrop = 2,      // arg[0]: dropped, arg[1]: total
+    kEventCorruptForward = 3,    // arg[0]: corrupted, arg[1]: total
+    kEventCorrupt = 4,           // arg[0]: corrupted, arg[1]: total, arg[2]: offset,
+                                 // arg16: old byte << 8 | new byte
+    kEventDroplistDrop = 5,      // arg[0]: packet number
+    kEventUnknownBinding = 6,    // rebind: no binding for dst:dst_port, arg16: NatDropReason
+    kEventUnknownSource = 7,     // rebind: unknown src
+    kEventComplexDrop = 8,       // arg16: ComplexDropReason, arg[0]: remaining burst
+    kEventChannelDelay = 9,      // arg[0]: jitter (signed), arg[1]: transmission delay, in us
+    kEventRebound = 10,          // rebind: translated the packet, the record holds the new flow,
+                                 // arg16: ReboundField
+    kEventLossModelDrop = 11,    // arg16: LossModelKind, arg[0]: dropped, arg[1]: total,
+                                 // arg[2]: state of the model
+
+    // State changes.
+    kEventBlackholeOn = 64,
+    kEventBlackholeOff = 65,
+    kEventRebind = 66,           // src:src_port -> dst:dst_port are the old and new NAT binding
+    kEventRebindAddress = 67,    // src -> dst are the old and new NAT address of a client
+    kEventLinkRate = 68,         // arg16: LinkRateChange, arg[0] | arg[1] << 32: rate in bit/s
+    kEventOverloaded = 69,       // the simulator fell behind the wall clock, arg[0]: lag in us
+    kEventOverloadEnd = 70,      // the simulator caught up, arg[0]: duration of the overload in us
+    kEventBindingExpired = 71,   // src:src_port -> dst:dst_port is the expired NAT binding
+};
+
+// Events below this type are per-packet events.
+static const uint8_t kEventFirstStateChange = 64;
+
+enum ComplexDropReason : uint16_t {
+    kComplexDropCyclic = 0,
+    kComplexDropBurst = 1,
+    kComplexDropRandom = 2,
+};
+
+enum ReboundField : uint16_t {
+    kReboundSource = 0,      // towards the server
+    kReboundDestination = 1, // towards the client
+};
+
+enum NatDropReason : uint16_t {
+    kNatNoBinding = 0,       // towards a client, no binding for the port
+    kNatFiltered = 1,        // towards a client, the binding doesn't accept the source
+    kNatPortsExhausted = 2,  // towards a server, all ports are in use
+};
+
+enum LossModelKind : uint16_t {
+    kLossBernoulli = 0,
+    kLossGilbertElliott = 1, // state 0: good, 1: bad
+    kLossMarkov4 = 2,        // state 1 to 4
+    kLossTrace = 3,
+};
+
+// The names of the loss models in impairment specs, by LossModelKind.
+static const char *const kLossModelNames[] = {"bernoulli", "gilbert", "markov4", "losstrace"};
+
+enum LinkRateChange : uint16_t {
+    kLinkRateHigh = 0,
+    kLinkRateLow = 1,
+    kLinkRateLinear = 2,
+    kLinkRatePeriodic = 3,
+};
+
+// A fixed-size log record. Addresses are in network byte order, IPv4
+// addresses use the first 4 bytes.
+struct EventRecord {
+    uint64_t time;      // simulation time, in ns
+    uint8_t type;       // EventType
+    uint8_t family;     // 4 or 6, 0 if the record has no addresses
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint16_t arg16;
+    uint32_t size;      // UDP payload size
+    uint32_t arg[3];
+    uint8_t src[16];
+    uint8_t dst[16];
+};
+
+static_assert(sizeof(EventRecord) == 64, "EventRecord should fill a cache line");
+
+#endif /* EVENT_LOG_RECORD_H */
@@ -0,0 +1,169 @@
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "event-log.h"
+#include "packet-capture.h"
+#include "thread-placement.h"
+
+#include "ns3/global-value.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+using namespace ns3;
+using namespace std;
+
+static GlobalValue g_eventLogLevel = GlobalValue("EventLogLevel",
+    "Event log verbosity: 0 = off, 1 = state changes only, 2 = also per-packet events",
+    UintegerValue(EventLog::kPackets), MakeUintegerChecker<uint32_t>(0, 2));
+
+static GlobalValue g_eventLogFile = GlobalValue("EventLogFile",
+    "File that the binary event log is written to",
+    StringValue("/logs/events.bin"), MakeStringChecker());
+
+EventLog &EventLog::Get() {
+    static EventLog log;
+    return log;
+}
+
+EventLog::EventLog()
+    : level_(kOff), notes_(PacketCapture::Get().IsEnabled()), file_(nullptr), ring_(nullptr),
+      enqueue_pos_(0), dequeue_pos_(0), written_(0), dropped_(0), stop_(false) {
+    UintegerValue level;
+    g_eventLogLevel.GetValue(level);
+    StringValue filename;
+    g_eventLogFile.GetValue(filename);
+    if (level.Get() == kOff) return;
+
+    file_ = fopen(filename.Get().c_str(), "wb");
+    if (!file_) {
+        cout << "Can't open event log " << filename.Get() << ": " << strerror(errno)
+             << ", disabling event log" << endl;
+        return;
+    }
+    EventLogFileHeader hdr;
+    memcpy(hdr.magic, kEventLogMagic, sizeof(hdr.magic));
+    hdr.version = kEventLogVersion;
+    hdr.record_size = sizeof(EventRecord);
+    fwrite(&hdr, sizeof(hdr), 1, file_);
+
+    ring_ = new Slot[kRingSize];
+    for (uint32_t i = 0; i < kRingSize; i++) ring_[i].seq.store(i, memory_order_relaxed);
+    level_.store(level.Get());
+    writer_ = thread(&EventLog::WriterLoop, this);
+}
+
+EventLog::~EventLog() {
+    Stop();
+    delete[] ring_;
+}
+
+EventRecord EventLog::Record(EventType type) {
+    EventRecord r;
+    memset(&r, 0, sizeof(r));
+    r.type = type;
+    return r;
+}
+
+void EventLog::SetAddress(uint8_t *dst, uint8_t &family, const Address &addr) {
+    if (Ipv6Address::IsMatchingType(addr)) {
+        Ipv6Address::ConvertFrom(addr).Serialize(dst);
+        family = 6;
+    } else {
+        Ipv4Address::ConvertFrom(addr).Serialize(dst);
+        family = 4;
+    }
+}
+
+EventRecord EventLog::PacketRecord(EventType type, const QuicPacket &qp) {
+    EventRecord r = Record(type);
+    SetAddress(r.src, r.family, qp.GetSource());
+    SetAddress(r.dst, r.family, qp.GetDestination());
+    r.src_port = qp.GetSourcePort();
+    r.dst_port = qp.GetDestinationPort();
+    r.size = qp.GetUdpPayloadSize();
+    return r;
+}
+
+EventRecord EventLog::LinkRateRecord(LinkRateChange change, uint64_t bps) {
+    EventRecord r = Record(kEventLinkRate);
+    r.arg16 = change;
+    r.arg[0] = bps & 0xffffffff;
+    r.arg[1] = bps >> 32;
+    return r;
+}
+
+void EventLog::Log(EventRecord &r) {
+    const Level level = r.type < kEventFirstStateChange ? kPackets : kStateChanges;
+    if (level == kPackets && notes_) PacketCapture::Get().Note(r);
+    if (level > level_.load(memory_order_relaxed)) return;
+    r.time = Simulator::Now().GetNanoSeconds();
+    // Bounded multi-producer queue: a slot is free for position pos if its
+    // sequence number is pos, and filled if it is pos + 1.
+    uint64_t pos = enqueue_pos_.load(memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+        slot = &ring_[pos & (kRingSize - 1)];
+        const uint64_t seq = slot->seq.load(memory_order_acquire);
+        const int64_t diff = (int64_t)seq - (int64_t)pos;
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            // The writer thread fell behind. Never block the simulation.
+            dropped_.fetch_add(1, memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueue_pos_.load(memory_order_relaxed);
+        }
+    }
+    slot->record = r;
+    slot->seq.store(pos + 1, memory_order_release);
+}
+
+uint32_t EventLog::Drain() {
+    static const uint32_t kBatch = 256;
+    EventRecord batch[kBatch];
+    uint32_t total = 0;
+    while (true) {
+        uint32_t n = 0;
+        while (n < kBatch) {
+            Slot &slot = ring_[dequeue_pos_ & (kRingSize - 1)];
+            if (slot.seq.load(memory_order_acquire) != dequeue_pos_ + 1) break;
+            batch[n++] = slot.record;
+            slot.seq.store(dequeue_pos_ + kRingSize, memory_order_release);
+            dequeue_pos_++;
+        }
+        if (n == 0) break;
+        fwrite(batch, sizeof(EventRecord), n, file_);
+        total += n;
+    }
+    written_.fetch_add(total, memory_order_relaxed);
+    return total;
+}
+
+void EventLog::WriterLoop() {
+    ThreadPlacement::Get().PlaceCurrentThread(ThreadPlacement::kHelper, "event log");
+    while (!stop_.load(memory_order_acquire)) {
+        if (Drain() == 0) {
+            fflush(file_);
+            this_thread::sleep_for(chrono::milliseconds(5));
+        }
+    }
+    Drain();
+}
+
+void EventLog::Stop() {
+    if (!file_) return;
+    level_.store(kOff);
+    stop_.store(true, memory_order_release);
+    if (writer_.joinable()) writer_.join();
+    fclose(file_);
+    file_ = nullptr;
+    cout << "Event log: " << written_.load() << " records written";
+    if (dropped_.load() > 0) cout << ", " << dropped_.load() << " dropped (writer fell behind)";
+    cout << endl;
+}
@@ -0,0 +1,83 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+#include "ns3/address.h"
+#include "event-log-record.h"
+#include "quic-packet.h"
+
+using namespace ns3;
+
+// EventLog is a structured, binary replacement for printing a line per
+// packet to stdout. Callers fill in fixed-size EventRecords, which are pushed
+// into a lock-free ring. A background thread drains the ring to a file
+// (EventLogFile, /logs/events.bin by default), and the event-log-decode tool
+// turns that file back into the text the error models used to print.
+//
+// The amount of logging is set by EventLogLevel:
+//   0: nothing is logged,
+//   1: only state changes (rebinds, blackhole on / off, link rate changes),
+//   2: per-packet events as well (the default).
+// If the ring is full, records are dropped rather than blocking the
+// simulation, and the number of dropped records is printed at the end.
+//
+// While a PacketCapture runs, per-packet records are created regardless of
+// the level, and handed to the capture as notes for the packet.
+class EventLog {
+public:
+    enum Level { kOff = 0, kStateChanges = 1, kPackets = 2 };
+
+    static EventLog &Get();
+
+    bool IsEnabled(Level level) const {
+        return level <= level_.load(std::memory_order_relaxed) || (level == kPackets && notes_);
+    }
+
+    // Create a record for an event. PacketRecord() fills in the flow and the
+    // UDP payload size of qp.
+    static EventRecord Record(EventType type);
+    static EventRecord PacketRecord(EventType type, const QuicPacket &qp);
+    static void SetAddress(uint8_t *dst, uint8_t &family, const Address &addr);
+    static EventRecord LinkRateRecord(LinkRateChange change, uint64_t bps);
+
+    // Stamp the record with the current simulation time and queue it,
+    // unless its type is filtered out by EventLogLevel.
+    // Safe to call from multiple threads.
+    void Log(EventRecord &r);
+
+    // Drain the ring and close the file. Called when the simulation ends.
+    void Stop();
+
+private:
+    EventLog();
+    ~EventLog();
+    EventLog(const EventLog &) = delete;
+    EventLog &operator=(const EventLog &) = delete;
+
+    void WriterLoop();
+    uint32_t Drain();
+
+    static const uint32_t kRingSize = 1 << 16; // records, must be a power of 2
+
+    struct Slot {
+        std::atomic<uint64_t> seq;
+        EventRecord record;
+    };
+
+    std::atomic<int> level_;
+    bool notes_; // pass per-packet records to the PacketCapture
+    FILE *file_;
+    Slot *ring_;
+    std::atomic<uint64_t> enqueue_pos_;
+    uint64_t dequeue_pos_;
+    std::atomic<uint64_t> written_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<bool> stop_;
+    std::thread writer_;
+};
+
+#endif /* EVENT_LOG_H */
@@ -0,0 +1,67 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// FrameRing is a bounded single-producer / single-consumer queue of frames,
+// used to hand frames between a network I/O thread and the simulator thread
+// without locks. Every slot has a fixed-size buffer, so the producer can
+// receive directly into the ring, and the consumer can send directly out of
+// it. Both sides work in batches: the producer fills several slots and
+// publishes them at once, the consumer processes several slots and releases
+// them at once.
+class FrameRing {
+public:
+    // slots is rounded up to a power of 2.
+    FrameRing(uint32_t slots, uint32_t frame_size)
+        : frame_size_(frame_size), head_(0), tail_(0) {
+        slots_ = 1;
+        while (slots_ < slots) slots_ <<= 1;
+        buffers_.resize((std::size_t)slots_ * frame_size_);
+        lengths_.resize(slots_);
+    }
+
+    uint32_t GetFrameSize() const { return frame_size_; }
+
+    // Producer side.
+    uint32_t WritableCount() const {
+        return slots_ - (tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire));
+    }
+    // The buffer i slots after the last published slot, i < WritableCount().
+    uint8_t *WriteSlot(uint32_t i) {
+        return &buffers_[(std::size_t)((tail_.load(std::memory_order_relaxed) + i) & (slots_ - 1)) * frame_size_];
+    }
+    void SetLength(uint32_t i, uint32_t len) {
+        lengths_[(tail_.load(std::memory_order_relaxed) + i) & (slots_ - 1)] = len;
+    }
+    // Make the next n slots visible to the consumer.
+    void Publish(uint32_t n) { tail_.store(tail_.load(std::memory_order_relaxed) + n, std::memory_order_release); }
+
+    // Consumer side.
+    uint32_t ReadableCount() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_relaxed);
+    }
+    // The i-th unread slot, i < ReadableCount().
+    uint8_t *ReadSlot(uint32_t i, uint32_t &len) {
+        const uint32_t slot = (head_.load(std::memory_order_relaxed) + i) & (slots_ - 1);
+        len = lengths_[slot];
+        return &buffers_[(std::size_t)slot * frame_size_];
+    }
+    // Hand the first n unread slots back to the producer.
+    void Release(uint32_t n) { head_.store(head_.load(std::memory_order_relaxed) + n, std::memory_order_release); }
+
+private:
+    uint32_t slots_;
+    const uint32_t frame_size_;
+    std::vector<uint8_t> buffers_;
+    std::vector<uint32_t> lengths_;
+    // Written by the consumer and the producer respectively, kept on
+    // separate cache lines.
+    alignas(64) std::atomic<uint32_t> head_;
+    alignas(64) std::atomic<uint32_t> tail_;
+};
+
+#endif /* FRAME_RING_H */
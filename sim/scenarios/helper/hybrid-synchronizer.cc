@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "hybrid-synchronizer.h"
+
+#include "ns3/abort.h"
+#include "ns3/global-value.h"
+#include "ns3/nstime.h"
+#include "ns3/realtime-simulator-impl.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+
+using namespace ns3;
+using namespace std;
+
+static GlobalValue g_waitStrategy = GlobalValue("WaitStrategy",
+    "How the simulator waits for the next event: sleep (on a condition variable), "
+    "or hybrid (sleep until SpinWindow before the event, then spin)",
+    StringValue("sleep"), MakeStringChecker());
+
+static GlobalValue g_spinWindow = GlobalValue("SpinWindow",
+    "With --WaitStrategy=hybrid, how long before an event the simulator stops sleeping and starts spinning",
+    TimeValue(MicroSeconds(100)), MakeTimeChecker());
+
+NS_OBJECT_ENSURE_REGISTERED(HybridSynchronizer);
+
+Ptr<HybridSynchronizer> HybridSynchronizer::installed_;
+
+TypeId HybridSynchronizer::GetTypeId(void) {
+    static TypeId tid = TypeId("HybridSynchronizer")
+        .SetParent<Synchronizer>()
+        .AddConstructor<HybridSynchronizer>();
+    return tid;
+}
+
+HybridSynchronizer::HybridSynchronizer()
+    : spin_window_(0), event_start_(0), condition_(false), waits_(0), interrupted_(0),
+      max_error_(0), spun_(0) {
+    memset(buckets_, 0, sizeof(buckets_));
+    StringValue strategy;
+    g_waitStrategy.GetValue(strategy);
+    NS_ABORT_MSG_IF(strategy.Get() != "sleep" && strategy.Get() != "hybrid",
+                    "Unknown WaitStrategy: " << strategy.Get());
+    if (strategy.Get() == "hybrid") {
+        TimeValue window;
+        g_spinWindow.GetValue(window);
+        spin_window_ = window.Get().GetNanoSeconds();
+    }
+    error_histogram_ = CounterRegistry::Get().RegisterHistogram("sim.wakeup_error.ns");
+    origin_ = Clock::now();
+}
+
+void HybridSynchronizer::Install() {
+    Ptr<RealtimeSimulatorImpl> impl = DynamicCast<RealtimeSimulatorImpl>(Simulator::GetImplementation());
+    if (!impl) return;
+    installed_ = CreateObject<HybridSynchronizer>();
+    impl->SetSynchronizer(installed_);
+}
+
+void HybridSynchronizer::Report() {
+    if (installed_) installed_->PrintReport();
+}
+
+uint64_t HybridSynchronizer::GetNormalizedRealtime() const {
+    return chrono::duration_cast<chrono::nanoseconds>(Clock::now() - origin_).count();
+}
+
+bool HybridSynchronizer::DoRealtime(void) {
+    return true;
+}
+
+uint64_t HybridSynchronizer::DoGetCurrentRealtime(void) {
+    return GetNormalizedRealtime();
+}
+
+void HybridSynchronizer::DoSetOrigin(uint64_t ns) {
+    // From now on, the wall clock and the simulation time (in ns) advance
+    // together.
+    origin_ = Clock::now() - chrono::nanoseconds(ns);
+}
+
+int64_t HybridSynchronizer::DoGetDrift(uint64_t ns) {
+    return (int64_t)GetNormalizedRealtime() - (int64_t)ns;
+}
+
+bool HybridSynchronizer::DoSynchronize(uint64_t nsCurrent, uint64_t nsDelay) {
+    const uint64_t target = nsCurrent + nsDelay;
+    uint64_t now = GetNormalizedRealtime();
+    if (now >= target) return true;
+
+    if (target - now > spin_window_) {
+        unique_lock<mutex> lock(mutex_);
+        const Clock::time_point wake = origin_ + chrono::nanoseconds(target - spin_window_);
+        if (cv_.wait_until(lock, wake, [this] { return condition_.load(); })) {
+            // Another thread scheduled an event, which may be due earlier.
+            interrupted_++;
+            return false;
+        }
+    }
+    const uint64_t spin_start = GetNormalizedRealtime();
+    while ((now = GetNormalizedRealtime()) < target) {
+        if (condition_.load(memory_order_relaxed)) {
+            spun_ += now - spin_start;
+            interrupted_++;
+            return false;
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+    if (now > spin_start) spun_ += now - spin_start;
+
+    const uint64_t error = now - target;
+    waits_++;
+    uint32_t bucket = error == 0 ? 0 : 64 - __builtin_clzll(error);
+    if (bucket >= kHistogramBuckets) bucket = kHistogramBuckets - 1;
+    buckets_[bucket]++;
+    error_histogram_.Record(error);
+    max_error_ = max(max_error_, error);
+    return true;
+}
+
+void HybridSynchronizer::DoSignal(void) {
+    {
+        lock_guard<mutex> lock(mutex_);
+        condition_ = true;
+    }
+    cv_.notify_one();
+}
+
+void HybridSynchronizer::DoSetCondition(bool condition) {
+    condition_ = condition;
+}
+
+void HybridSynchronizer::DoEventStart(void) {
+    event_start_ = GetNormalizedRealtime();
+}
+
+uint64_t HybridSynchronizer::DoEventEnd(void) {
+    return GetNormalizedRealtime() - event_start_;
+}
+
+void HybridSynchronizer::PrintReport() const {
+    if (waits_ == 0) return;
+    // Upper bound of the bucket that contains the q-quantile, in ns.
+    auto quantile = [this](double q) {
+        return HistogramQuantile(waits_, q, [this](uint32_t i) { return buckets_[i]; });
+    };
+    cout << "Wake-up error (";
+    if (spin_window_ == 0) cout << "sleep";
+    else cout << "hybrid, spin window " << spin_window_ / 1000 << "us";
+    cout << "): " << waits_ << " waits (" << interrupted_ << " cut short), p50 < " << quantile(0.5)
+         << "ns, p99 < " << quantile(0.99) << "ns, p99.9 < " << quantile(0.999) << "ns, max "
+         << max_error_ << "ns";
+    if (spin_window_ > 0) cout << ", spun for " << spun_ / 1000000 << "ms";
+    cout << endl;
+}
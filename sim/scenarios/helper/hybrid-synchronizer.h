@@ -0,0 +1,77 @@
+#ifndef HYBRID_SYNCHRONIZER_H
+#define HYBRID_SYNCHRONIZER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#include "ns3/synchronizer.h"
+#include "counters.h"
+
+using namespace ns3;
+
+// HybridSynchronizer replaces the WallClockSynchronizer of the
+// RealtimeSimulatorImpl, and decides how the simulator thread waits for the
+// next event (WaitStrategy):
+//  - sleep: wait on a condition variable until the event is due, like ns-3
+//    does. The thread wakes up when the OS gets to it, typically 50-100us
+//    late.
+//  - hybrid: sleep until SpinWindow before the event is due, then spin on the
+//    clock. Events run within a few hundred ns of their time, at the cost of
+//    burning a core for up to SpinWindow per wait.
+// Either way, waits are cut short when another thread schedules an event.
+//
+// For every wait that ran to its end, the synchronizer records the wake-up
+// error: how late the simulator thread continued. Report() prints its
+// distribution.
+class HybridSynchronizer : public Synchronizer {
+public:
+    static TypeId GetTypeId(void);
+    HybridSynchronizer();
+
+    // Install a HybridSynchronizer into the simulator. Call before
+    // Simulator::Run(). Does nothing unless the simulator is a
+    // RealtimeSimulatorImpl.
+    static void Install();
+    // Print the wake-up error of the installed synchronizer.
+    static void Report();
+
+protected:
+    bool DoRealtime(void) override;
+    uint64_t DoGetCurrentRealtime(void) override;
+    void DoSetOrigin(uint64_t ns) override;
+    int64_t DoGetDrift(uint64_t ns) override;
+    bool DoSynchronize(uint64_t nsCurrent, uint64_t nsDelay) override;
+    void DoSignal(void) override;
+    void DoSetCondition(bool condition) override;
+    void DoEventStart(void) override;
+    uint64_t DoEventEnd(void) override;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // The wall clock time, in ns of simulation time.
+    uint64_t GetNormalizedRealtime() const;
+    void PrintReport() const;
+
+    static Ptr<HybridSynchronizer> installed_;
+
+    uint64_t spin_window_; // in ns, 0: sleep only
+
+    Clock::time_point origin_; // wall clock time of simulation time 0
+    uint64_t event_start_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic<bool> condition_;
+
+    uint64_t waits_, interrupted_;
+    uint64_t max_error_;  // in ns
+    uint64_t spun_;       // in ns
+    uint64_t buckets_[kHistogramBuckets]; // see counters-layout.h, in ns
+    Histogram error_histogram_;
+};
+
+#endif /* HYBRID_SYNCHRONIZER_H */
@@ -0,0 +1,448 @@
+#include <algorithm>
+#include <climits>
+#include <sstream>
+
+#include "impairment-pipeline.h"
+#include "event-log.h"
+#include "packet-capture.h"
+
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+
+using namespace ns3;
+using namespace std;
+
+DropStage::DropStage(int rate, int burst, const string &stream)
+    : rate_(rate), burst_(burst), rng_(stream),
+      dropped_in_a_row_(0), dropped_(0), forwarded_(0) {}
+
+void DropStage::Reset() {
+    dropped_in_a_row_ = 0;
+    dropped_ = 0;
+    forwarded_ = 0;
+}
+
+bool DropStage::Process(QuicPacket &qp, DirectionCounters &counters) {
+    if (!qp.IsValid()) return false;
+
+    bool shouldDrop = false;
+    if (dropped_in_a_row_ >= burst_) {
+        dropped_in_a_row_ = 0;
+    } else if ((int)rng_.Below(100) < rate_) {
+        dropped_in_a_row_++;
+        shouldDrop = true;
+    } else {
+        dropped_in_a_row_ = 0;
+    }
+
+    if (shouldDrop)
+        dropped_++;
+    else
+        forwarded_++;
+    EventLog &log = EventLog::Get();
+    if (log.IsEnabled(EventLog::kPackets)) {
+        EventRecord r = EventLog::PacketRecord(shouldDrop ? kEventDropRateDrop : kEventDropRateForward, qp);
+        r.arg[0] = dropped_;
+        r.arg[1] = dropped_ + forwarded_;
+        log.Log(r);
+    }
+    return shouldDrop;
+}
+
+CorruptStage::CorruptStage(int rate, int burst, const string &stream)
+    : rate_(rate), burst_(burst), rng_(stream),
+      corrupted_in_a_row_(0), corrupted_(0), forwarded_(0) {}
+
+void CorruptStage::Reset() {
+    corrupted_in_a_row_ = 0;
+    corrupted_ = 0;
+    forwarded_ = 0;
+}
+
+bool CorruptStage::Process(QuicPacket &qp, DirectionCounters &counters) {
+    if (!qp.IsValid()) return false;
+
+    bool shouldCorrupt = false;
+    if (qp.IsVersionNegotiationPacket()) {
+        // Clients ignore Version Negotiation packets that contain the version
+        // they offered, see CorruptRateErrorModel.
+        corrupted_in_a_row_ = 0;
+    } else if (qp.GetUdpPayloadSize() == 0) {
+        // There is nothing to corrupt.
+    } else if (corrupted_in_a_row_ >= burst_) {
+        corrupted_in_a_row_ = 0;
+    } else if ((int)rng_.Below(100) < rate_) {
+        corrupted_in_a_row_++;
+        shouldCorrupt = true;
+    } else {
+        corrupted_in_a_row_ = 0;
+    }
+
+    int pos = 0;
+    uint8_t old_n = 0;
+    uint8_t new_n = 0;
+    if (shouldCorrupt) {
+        corrupted_++;
+        // Corrupt a byte in the 50 bytes of the UDP payload.
+        // This way, we will frequently hit the QUIC header.
+        pos = rng_.Below(min(uint32_t(50), qp.GetUdpPayloadPrefixSize() - 1) + 1);
+        old_n = qp.GetPayloadByte(pos);
+        do {
+            new_n = rng_.Below(256);
+        } while (new_n == old_n);
+        qp.SetPayloadByte(pos, new_n);
+        counters.corrupted_packets.Add();
+        counters.corrupted_bytes.Add(qp.GetUdpPayloadSize());
+    } else {
+        forwarded_++;
+    }
+
+    EventLog &log = EventLog::Get();
+    if (log.IsEnabled(EventLog::kPackets)) {
+        EventRecord r = EventLog::PacketRecord(shouldCorrupt ? kEventCorrupt : kEventCorruptForward, qp);
+        r.arg[0] = corrupted_;
+        r.arg[1] = corrupted_ + forwarded_;
+        r.arg[2] = pos;
+        r.arg16 = old_n << 8 | new_n;
+        log.Log(r);
+    }
+    return false;
+}
+
+LossStage::LossStage(Ptr<LossModel> model, uint16_t kind)
+    : model_(model), kind_(kind), dropped_(0), total_(0) {}
+
+bool LossStage::Process(QuicPacket &qp, DirectionCounters &counters) {
+    if (!qp.IsValid()) return false;
+    total_++;
+    if (!model_->Next()) return false;
+    dropped_++;
+
+    EventLog &log = EventLog::Get();
+    if (log.IsEnabled(EventLog::kPackets)) {
+        EventRecord r = EventLog::PacketRecord(kEventLossModelDrop, qp);
+        r.arg16 = kind_;
+        r.arg[0] = dropped_;
+        r.arg[1] = total_;
+        r.arg[2] = model_->GetState();
+        log.Log(r);
+    }
+    return true;
+}
+
+DroplistStage::DroplistStage(const string &list, bool per_flow) {
+    drops_.Add(list);
+    numbering_.SetPerFlow(per_flow);
+}
+
+void DroplistStage::Reset() {
+    numbering_.Reset();
+}
+
+bool DroplistStage::Process(QuicPacket &qp, DirectionCounters &counters) {
+    if (!qp.IsValid()) return false;
+    const uint64_t packet_num = numbering_.Next(qp);
+    if (!drops_.Contains(packet_num)) return false;
+
+    EventLog &log = EventLog::Get();
+    if (log.IsEnabled(EventLog::kPackets)) {
+        EventRecord r = EventLog::PacketRecord(kEventDroplistDrop, qp);
+        r.arg[0] = packet_num;
+        log.Log(r);
+    }
+    return true;
+}
+
+BlackholeStage::BlackholeStage(Time on, Time off, int repeat)
+    : on_(on), off_(off), enabled_(false) {
+    Simulator::Schedule(on_, &BlackholeStage::Toggle, this, true, repeat);
+}
+
+void BlackholeStage::Toggle(bool enable, int remaining) {
+    EventRecord r = EventLog::Record(enable ? kEventBlackholeOn : kEventBlackholeOff);
+    EventLog::Get().Log(r);
+    enabled_ = enable;
+    if (enable)
+        Simulator::Schedule(off_, &BlackholeStage::Toggle, this, false, remaining);
+    else if (--remaining > 0)
+        Simulator::Schedule(on_, &BlackholeStage::Toggle, this, true, remaining);
+}
+
+bool BlackholeStage::Process(QuicPacket &qp, DirectionCounters &counters) {
+    // This drops all packets, not only UDP packets.
+    return enabled_;
+}
+
+NatStage::NatStage(NatTable::Mode mode, Time idle, bool preserve_ports, const string &stream) : nat_(stream) {
+    nat_.SetMode(mode);
+    nat_.SetPortPreservation(preserve_ports);
+    nat_.SetIdleTimeout(idle);
+}
+
+RebindStage::RebindStage(Time first, Time freq, bool rebind_addr, NatTable::Mode mode, Time idle, bool preserve_ports)
+    : NatStage(mode, idle, preserve_ports, "rebind"), freq_(freq), rebind_addr_(rebind_addr) {
+    cout << Simulator::Now().GetSeconds() << "s: first rebind in " << first.GetSeconds() << "s";
+    if (!freq.IsZero())
+        cout << ", frequency " << freq.GetSeconds() << "s";
+    cout << endl;
+    Simulator::Schedule(first, &RebindStage::DoRebind, this);
+}
+
+void RebindStage::DoRebind() {
+    nat_.Rebind(rebind_addr_);
+    if (!freq_.IsZero())
+        Simulator::Schedule(freq_, &RebindStage::DoRebind, this);
+}
+
+bool NatStage::Process(QuicPacket &qp, DirectionCounters &counters) {
+    if (!qp.IsValid()) return false;
+    switch (nat_.Translate(qp)) {
+    case NatTable::kUnchanged:
+        break;
+    case NatTable::kTranslatedSource:
+    case NatTable::kTranslatedDestination:
+        counters.rebound_packets.Add();
+        counters.rebound_bytes.Add(qp.GetUdpPayloadSize());
+        break;
+    case NatTable::kDrop:
+        return true;
+    }
+    return false;
+}
+
+NS_OBJECT_ENSURE_REGISTERED(ImpairmentPipeline);
+
+TypeId ImpairmentPipeline::GetTypeId(void) {
+    static TypeId tid = TypeId("ImpairmentPipeline")
+        .SetParent<ErrorModel>()
+        .AddConstructor<ImpairmentPipeline>()
+        ;
+    return tid;
+}
+
+ImpairmentPipeline::ImpairmentPipeline() : capture_interface_(-1) {}
+
+void ImpairmentPipeline::AddStage(Ptr<ImpairmentStage> stage) {
+    stages_.push_back(stage);
+}
+
+bool ImpairmentPipeline::IsEmpty() const {
+    return stages_.empty();
+}
+
+void ImpairmentPipeline::SetCounters(const DirectionCounters &counters) {
+    counters_ = counters;
+}
+
+void ImpairmentPipeline::SetCaptureInterface(uint32_t interface) {
+    capture_interface_ = interface;
+}
+
+void ImpairmentPipeline::DoReset(void) {
+    for (auto &stage : stages_) stage->Reset();
+}
+
+bool ImpairmentPipeline::DoCorrupt(Ptr<Packet> p) {
+    // All stages share one view of the packet. The view is invalid for
+    // packets that are not UDP packets.
+    QuicPacket qp = QuicPacket(p);
+    for (auto &stage : stages_) {
+        if (stage->Process(qp, counters_)) return true;
+    }
+    qp.Commit();
+    return false;
+}
+
+// Returns true for frames that the link would carry: unicast IPv4 and IPv6
+// packets, other than neighbor discovery.
+static bool IsRoutedFrame(const uint8_t *frame, uint32_t len) {
+    if (len < 14 || (frame[0] & 1)) return false;
+    const uint16_t type = frame[12] << 8 | frame[13];
+    if (type == 0x0800) return len >= 14 + 20;
+    if (type != 0x86dd || len < 14 + 40) return false;
+    const uint8_t *ip = frame + 14;
+    // ICMPv6 router / neighbor solicitations and advertisements, redirects.
+    if (ip[6] == 58 && len > 14 + 40 && ip[40] >= 133 && ip[40] <= 137) return false;
+    return true;
+}
+
+bool ImpairmentPipeline::ProcessFrame(uint8_t *frame, uint32_t len) {
+    if (!IsEnabled() || !IsRoutedFrame(frame, len)) return false;
+    lock_guard<mutex> lock(mutex_);
+    QuicPacket qp = QuicPacket(frame, len);
+    for (auto &stage : stages_) {
+        if (stage->Process(qp, counters_)) {
+            // The link device counts the PPP frame.
+            counters_.dropped_packets.Add();
+            counters_.dropped_bytes.Add(len - 14 + 2);
+            if (capture_interface_ >= 0)
+                PacketCapture::Get().CaptureFrame(capture_interface_, frame, len, PacketCapture::kDroppedByModel);
+            return true;
+        }
+    }
+    qp.Commit();
+    if (capture_interface_ >= 0)
+        PacketCapture::Get().CaptureFrame(capture_interface_, frame, len, PacketCapture::kForwarded);
+    return false;
+}
+
+// Parse "key=value,key=value" arguments.
+static map<string, string> ParseArgs(const string &stage, const string &args) {
+    map<string, string> kv;
+    stringstream ss(args);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (item.empty()) continue;
+        const size_t eq = item.find('=');
+        NS_ABORT_MSG_IF(eq == string::npos, "Invalid argument for " << stage << ": " << item);
+        kv[item.substr(0, eq)] = item.substr(eq + 1);
+    }
+    return kv;
+}
+
+static string TakeArg(map<string, string> &kv, const string &stage, const string &key, const string &def = "") {
+    auto it = kv.find(key);
+    if (it == kv.end()) {
+        NS_ABORT_MSG_IF(def.empty(), "Missing argument for " << stage << ": " << key);
+        return def;
+    }
+    const string v = it->second;
+    kv.erase(it);
+    return v;
+}
+
+// Parse a probability in percent, e.g. 0.3.
+static double ParseRate(const string &stage, const string &key, const string &value) {
+    size_t end = 0;
+    double rate = -1;
+    try {
+        rate = stod(value, &end);
+    } catch (const exception &) {
+    }
+    NS_ABORT_MSG_IF(end != value.size() || rate < 0 || rate > 100,
+                    "Invalid " << key << " for " << stage << ": " << value);
+    return rate;
+}
+
+// Parse an integer in [min, max].
+static int ParseInt(const string &stage, const string &key, const string &value, int min, int max) {
+    size_t end = 0;
+    long long n = 0;
+    try {
+        n = stoll(value, &end);
+    } catch (const exception &) {
+    }
+    NS_ABORT_MSG_IF(value.empty() || end != value.size() || n < min || n > max,
+                    "Invalid " << key << " for " << stage << ": " << value << " (expected " << min << " to " << max
+                               << ")");
+    return n;
+}
+
+static void CheckNoArgsLeft(const map<string, string> &kv, const string &stage) {
+    NS_ABORT_MSG_IF(!kv.empty(), "Unknown argument for " << stage << ": " << kv.begin()->first);
+}
+
+Ptr<ImpairmentStage> ImpairmentPipelineHelper::CreateStage(const string &name, const string &args, const string &direction) {
+    if (name == "droplist") {
+        // A list of packets, not key=value arguments.
+        stringstream ss(args);
+        string item, list;
+        bool per_flow = false;
+        while (getline(ss, item, ',')) {
+            if (item == "per_flow")
+                per_flow = true;
+            else
+                list += item + ",";
+        }
+        return ns3::Create<DroplistStage>(list, per_flow);
+    }
+
+    map<string, string> kv = ParseArgs(name, args);
+    const string stream = direction + "." + name;
+    Ptr<ImpairmentStage> stage;
+    if (name == "drop" || name == "corrupt") {
+        const int rate = ParseInt(name, "rate", TakeArg(kv, name, "rate"), 0, 100);
+        const int burst = ParseInt(name, "burst", TakeArg(kv, name, "burst", to_string(INT_MAX)), 0, INT_MAX);
+        if (name == "drop")
+            stage = ns3::Create<DropStage>(rate, burst, stream);
+        else
+            stage = ns3::Create<CorruptStage>(rate, burst, stream);
+    } else if (name == "bernoulli") {
+        const double rate = ParseRate(name, "rate", TakeArg(kv, name, "rate"));
+        stage = ns3::Create<LossStage>(ns3::Create<BernoulliLoss>(rate, stream), kLossBernoulli);
+    } else if (name == "gilbert") {
+        const double p = ParseRate(name, "p", TakeArg(kv, name, "p"));
+        const double r = ParseRate(name, "r", TakeArg(kv, name, "r"));
+        const double good = ParseRate(name, "good", TakeArg(kv, name, "good", "0"));
+        const double bad = ParseRate(name, "bad", TakeArg(kv, name, "bad", "100"));
+        stage = ns3::Create<LossStage>(ns3::Create<GilbertElliottLoss>(p, r, good, bad, stream), kLossGilbertElliott);
+    } else if (name == "markov4") {
+        const double p13 = ParseRate(name, "p13", TakeArg(kv, name, "p13"));
+        const double p31 = ParseRate(name, "p31", TakeArg(kv, name, "p31"));
+        const double p32 = ParseRate(name, "p32", TakeArg(kv, name, "p32", "0"));
+        const double p23 = ParseRate(name, "p23", TakeArg(kv, name, "p23", "0"));
+        const double p14 = ParseRate(name, "p14", TakeArg(kv, name, "p14", "0"));
+        stage = ns3::Create<LossStage>(ns3::Create<Markov4Loss>(p13, p31, p32, p23, p14, stream), kLossMarkov4);
+    } else if (name == "losstrace") {
+        stage = ns3::Create<LossStage>(ns3::Create<TraceLoss>(TakeArg(kv, name, "file")), kLossTrace);
+    } else if (name == "blackhole") {
+        const Time on = Time(TakeArg(kv, name, "on"));
+        const Time off = Time(TakeArg(kv, name, "off"));
+        const int repeat = ParseInt(name, "repeat", TakeArg(kv, name, "repeat", "1"), 1, INT_MAX);
+        stage = ns3::Create<BlackholeStage>(on, off, repeat);
+    } else if (name == "nat") {
+        const NatTable::Mode mode = NatTable::ParseMode(TakeArg(kv, name, "mode"));
+        const Time idle = Time(TakeArg(kv, name, "idle", "30s"));
+        const bool preserve_ports = ParseInt(name, "preserve_ports", TakeArg(kv, name, "preserve_ports", "1"), 0, 1) != 0;
+        ostringstream canonical;
+        canonical << name << " " << NatTable::GetModeName(mode) << " " << idle.GetNanoSeconds() << " "
+                  << preserve_ports;
+        if (!nat_) nat_ = ns3::Create<NatStage>(mode, idle, preserve_ports, "nat");
+        UseNatStage(name + ":" + args, canonical.str());
+        stage = nat_;
+    } else if (name == "rebind") {
+        const Time first = Time(TakeArg(kv, name, "first"));
+        const Time freq = Time(TakeArg(kv, name, "freq", "0s"));
+        const bool addr = ParseInt(name, "addr", TakeArg(kv, name, "addr", "0"), 0, 1) != 0;
+        const NatTable::Mode mode = NatTable::ParseMode(TakeArg(kv, name, "mode", "symmetric"));
+        const Time idle = Time(TakeArg(kv, name, "idle", "0s"));
+        const bool preserve_ports = ParseInt(name, "preserve_ports", TakeArg(kv, name, "preserve_ports", "1"), 0, 1) != 0;
+        ostringstream canonical;
+        canonical << name << " " << first.GetNanoSeconds() << " " << freq.GetNanoSeconds() << " " << addr << " "
+                  << NatTable::GetModeName(mode) << " " << idle.GetNanoSeconds() << " " << preserve_ports;
+        if (!nat_) nat_ = ns3::Create<RebindStage>(first, freq, addr, mode, idle, preserve_ports);
+        UseNatStage(name + ":" + args, canonical.str());
+        stage = nat_;
+    } else {
+        NS_ABORT_MSG("Unknown impairment stage: " << name);
+    }
+    CheckNoArgsLeft(kv, name);
+    return stage;
+}
+
+void ImpairmentPipelineHelper::UseNatStage(const string &item, const string &canonical) {
+    // The NAT translates both directions, so all pipelines share one stage,
+    // and all nat and rebind stages have to agree on its arguments.
+    if (nat_canonical_.empty()) {
+        nat_item_ = item;
+        nat_canonical_ = canonical;
+        return;
+    }
+    NS_ABORT_MSG_IF(canonical != nat_canonical_,
+                    "Conflicting NAT stages: " << nat_item_ << " and " << item
+                                               << " (both directions share one NAT, its stages must be the same)");
+}
+
+Ptr<ImpairmentPipeline> ImpairmentPipelineHelper::Create(const string &spec, const string &direction) {
+    Ptr<ImpairmentPipeline> pipeline = CreateObject<ImpairmentPipeline>();
+    stringstream ss(spec);
+    string item;
+    while (getline(ss, item, '+')) {
+        if (item.empty()) continue;
+        const size_t colon = item.find(':');
+        const string name = item.substr(0, colon);
+        const string args = colon == string::npos ? "" : item.substr(colon + 1);
+        pipeline->AddStage(CreateStage(name, args, direction));
+    }
+    return pipeline;
+}
@@ -0,0 +1,215 @@
+#ifndef IMPAIRMENT_PIPELINE_H
+#define IMPAIRMENT_PIPELINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ns3/error-model.h"
+#include "ns3/nstime.h"
+#include "counters.h"
+#include "drop-pattern.h"
+#include "loss-model.h"
+#include "nat-table.h"
+#include "quic-packet.h"
+#include "random-source.h"
+
+using namespace ns3;
+using namespace std;
+
+// An ImpairmentStage is one step of an ImpairmentPipeline.
+// Stages modify packets through the QuicPacket view that is shared by all
+// stages of the pipeline. The pipeline commits the modifications once, after
+// the last stage ran.
+class ImpairmentStage : public SimpleRefCount<ImpairmentStage> {
+public:
+    virtual ~ImpairmentStage() {}
+    // Returns true if the packet should be dropped. qp is not valid for
+    // packets that are not UDP packets. Drops are counted by the device,
+    // counters is for other changes to the packet.
+    virtual bool Process(QuicPacket &qp, DirectionCounters &counters) = 0;
+    virtual void Reset() {}
+};
+
+// Drops random UDP packets, at a given rate (in percent), but no more than
+// a given number of packets in a row. See DropRateErrorModel.
+class DropStage : public ImpairmentStage {
+public:
+    DropStage(int rate, int burst, const string &stream);
+    bool Process(QuicPacket &qp, DirectionCounters &counters);
+    void Reset();
+
+private:
+    int rate_;
+    int burst_;
+    RandomStream rng_;
+    int dropped_in_a_row_;
+    int dropped_;
+    int forwarded_;
+};
+
+// Corrupts one byte in the first 50 bytes of the UDP payload of random
+// packets, at a given rate (in percent), but no more than a given number of
+// packets in a row. Unlike the CorruptRateErrorModel, corrupted packets are
+// forwarded. Version Negotiation packets are never corrupted.
+class CorruptStage : public ImpairmentStage {
+public:
+    CorruptStage(int rate, int burst, const string &stream);
+    bool Process(QuicPacket &qp, DirectionCounters &counters);
+    void Reset();
+
+private:
+    int rate_;
+    int burst_;
+    RandomStream rng_;
+    int corrupted_in_a_row_;
+    int corrupted_;
+    int forwarded_;
+};
+
+// Drops the UDP packets that a LossModel decides are lost. kind is the
+// LossModelKind of the model, for logging.
+class LossStage : public ImpairmentStage {
+public:
+    LossStage(Ptr<LossModel> model, uint16_t kind);
+    bool Process(QuicPacket &qp, DirectionCounters &counters);
+
+private:
+    Ptr<LossModel> model_;
+    uint16_t kind_;
+    uint32_t dropped_;
+    uint32_t total_;
+};
+
+// Drops the UDP packets with the given numbers. Packet numbering starts at 1,
+// and counts the UDP packets that reach this stage, across all flows or per
+// flow. See DroplistErrorModel.
+class DroplistStage : public ImpairmentStage {
+public:
+    DroplistStage(const string &list, bool per_flow);
+    bool Process(QuicPacket &qp, DirectionCounters &counters);
+    void Reset();
+
+private:
+    DropPattern drops_;
+    PacketNumbering numbering_;
+};
+
+// Drops all packets while enabled. The stage starts disabled, is enabled
+// after `on`, and disabled again after `off`, repeat times.
+class BlackholeStage : public ImpairmentStage {
+public:
+    BlackholeStage(Time on, Time off, int repeat);
+    bool Process(QuicPacket &qp, DirectionCounters &counters);
+
+private:
+    void Toggle(bool enable, int remaining);
+
+    Time on_, off_;
+    // Toggled by the simulator, read by the thread running the pipeline.
+    std::atomic<bool> enabled_;
+};
+
+// A NAT in front of the clients. This stage translates both directions, so
+// the same stage has to be used for both directions. The directions may run
+// on different threads (see --ParallelImpairments), which the NatTable
+// allows. stream names the RandomStream of the NatTable.
+class NatStage : public ImpairmentStage {
+public:
+    NatStage(NatTable::Mode mode, Time idle, bool preserve_ports, const string &stream);
+    bool Process(QuicPacket &qp, DirectionCounters &counters);
+
+protected:
+    NatTable nat_;
+};
+
+// A NAT that periodically assigns new ports (and optionally, new addresses)
+// to all bindings. See RebindErrorModel.
+class RebindStage : public NatStage {
+public:
+    RebindStage(Time first, Time freq, bool rebind_addr, NatTable::Mode mode, Time idle, bool preserve_ports);
+    void DoRebind();
+
+private:
+    Time freq_;
+    bool rebind_addr_;
+};
+
+// The ImpairmentPipeline runs an ordered list of stages on every packet, in
+// a single DoCorrupt pass, over a single parsed view of the packet. A packet
+// dropped by a stage is not seen by the following stages.
+//
+// Instead of installing it on a device of the link, the pipeline can also
+// process the Ethernet frames that arrive from an endpoint, on the thread
+// that receives them (see ProcessFrame()).
+class ImpairmentPipeline : public ErrorModel {
+public:
+    static TypeId GetTypeId(void);
+    ImpairmentPipeline();
+    void AddStage(Ptr<ImpairmentStage> stage);
+    bool IsEmpty() const;
+    // The counters of the direction this pipeline is installed in.
+    void SetCounters(const DirectionCounters &counters);
+    // Run the stages on the Ethernet frame of len bytes at frame, modifying
+    // it in place. Returns true if the frame should be dropped, and counts
+    // the drop. Only unicast IP packets are processed: ARP and neighbor
+    // discovery on the endpoint's network are passed on unchanged. Can be
+    // called from any thread, calls are serialized.
+    bool ProcessFrame(uint8_t *frame, uint32_t len);
+    // Capture the frames that ProcessFrame() drops or modifies to this
+    // PacketCapture interface.
+    void SetCaptureInterface(uint32_t interface);
+
+private:
+    bool DoCorrupt(Ptr<Packet> p);
+    void DoReset(void);
+
+    vector<Ptr<ImpairmentStage>> stages_;
+    DirectionCounters counters_;
+    // Several interfaces can feed the same direction.
+    std::mutex mutex_;
+    int capture_interface_; // -1: don't capture
+};
+
+// ImpairmentPipelineHelper builds pipelines from a textual spec:
+// stages are separated by '+' and run in the order given, each stage is
+// written as name[:arguments], e.g.
+//   drop:rate=5,burst=3+corrupt:rate=2+droplist:1,5,8-10
+// The supported stages and their arguments are:
+//   drop:rate=<percent>[,burst=<packets>]
+//   corrupt:rate=<percent>[,burst=<packets>]
+//   droplist:<packets>[,<packets>...][,per_flow], see DropPattern
+//   bernoulli:rate=<percent>
+//   gilbert:p=<percent>,r=<percent>[,good=<percent>][,bad=<percent>]
+//   markov4:p13=<percent>,p31=<percent>[,p32=<percent>][,p23=<percent>][,p14=<percent>]
+//   losstrace:file=<path>
+//   blackhole:on=<time>,off=<time>[,repeat=<n>]
+//   nat:mode=<mode>[,idle=<time>][,preserve_ports=<0|1>]
+//   rebind:first=<time>[,freq=<time>][,addr=<0|1>][,mode=<mode>][,idle=<time>][,preserve_ports=<0|1>]
+// <mode> is full-cone, address-restricted, port-restricted or symmetric (the
+// default for rebind), see NatTable::Mode. With preserve_ports=1 (the
+// default), new bindings keep the client's port if it is free; with 0, they
+// get a random port. Bindings that replace an expired one get a new port.
+// A nat or rebind stage is shared by all pipelines created by the same
+// helper, since the NAT needs to translate both directions. All nat and
+// rebind stages of a helper must have the same arguments.
+class ImpairmentPipelineHelper {
+public:
+    // direction ("to_client" or "to_server") names the random streams of
+    // the stages, see RandomSource.
+    Ptr<ImpairmentPipeline> Create(const string &spec, const string &direction);
+
+private:
+    Ptr<ImpairmentStage> CreateStage(const string &name, const string &args, const string &direction);
+    // Check that the nat or rebind stage item, with its parsed arguments in
+    // canonical, matches the first one. Aborts if not.
+    void UseNatStage(const string &item, const string &canonical);
+
+    Ptr<NatStage> nat_;
+    string nat_item_, nat_canonical_;
+};
+
+#endif /* IMPAIRMENT_PIPELINE_H */
@@ -0,0 +1,145 @@
+#include <arpa/inet.h>
+#include <cstring>
+
+#include "l2-bridge.h"
+
+#include "ns3/abort.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv6.h"
+#include "ns3/packet.h"
+#include "ns3/queue-item.h"
+
+using namespace ns3;
+using namespace std;
+
+static const uint16_t kIpv4Protocol = 0x0800;
+static const uint16_t kIpv6Protocol = 0x86DD;
+
+// A QueueDiscItem for a bridged packet. The packet still carries its IP
+// header, so there's nothing to add when it's dequeued.
+class BridgeQueueDiscItem : public QueueDiscItem {
+public:
+    BridgeQueueDiscItem(Ptr<Packet> p, const Address &addr, uint16_t protocol)
+        : QueueDiscItem(p, addr, protocol) {}
+    void AddHeader() override {}
+    bool Mark() override { return false; }
+};
+
+L2Bridge::L2Bridge(Ptr<NetDevice> emu, Ptr<NetDevice> link)
+    : emu_(emu), link_(link), net4_(0), mask4_(0) {
+    Ptr<Node> node = emu->GetNode();
+    tc_ = node->GetObject<TrafficControlLayer>();
+    NS_ABORT_MSG_IF(!tc_, "L2Bridge needs the internet stack");
+
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+    const int32_t if4 = ipv4->GetInterfaceForDevice(emu);
+    NS_ABORT_MSG_IF(if4 < 0 || ipv4->GetNAddresses(if4) == 0, "L2Bridge: no IPv4 address on the emulated interface");
+    const Ipv4InterfaceAddress addr4 = ipv4->GetAddress(if4, 0);
+    mask4_ = addr4.GetMask().Get();
+    net4_ = addr4.GetLocal().Get() & mask4_;
+
+    memset(net6_, 0, sizeof(net6_));
+    memset(mask6_, 0, sizeof(mask6_));
+    Ptr<Ipv6> ipv6 = node->GetObject<Ipv6>();
+    const int32_t if6 = ipv6->GetInterfaceForDevice(emu);
+    for (uint32_t i = 0; if6 >= 0 && i < ipv6->GetNAddresses(if6); i++) {
+        const Ipv6InterfaceAddress addr6 = ipv6->GetAddress(if6, i);
+        if (addr6.GetAddress().IsLinkLocal()) continue;
+        addr6.GetAddress().GetBytes(net6_);
+        const uint8_t len = addr6.GetPrefix().GetPrefixLength();
+        for (uint8_t b = 0; b < 16; b++) {
+            mask6_[b] = len >= 8 * (b + 1) ? 0xff : len > 8 * b ? (uint8_t)(0xff << (8 - (len - 8 * b))) : 0;
+            net6_[b] &= mask6_[b];
+        }
+        break;
+    }
+
+    emu->SetReceiveCallback(MakeCallback(&L2Bridge::ReceiveFromEmu, this));
+    link->SetReceiveCallback(MakeCallback(&L2Bridge::ReceiveFromLink, this));
+}
+
+bool L2Bridge::OnSubnet4(const uint8_t *addr) const {
+    uint32_t a;
+    memcpy(&a, addr, 4);
+    return (ntohl(a) & mask4_) == net4_;
+}
+
+bool L2Bridge::OnSubnet6(const uint8_t *addr) const {
+    if (mask6_[0] == 0) return false; // no global address
+    for (int b = 0; b < 16; b++)
+        if ((addr[b] & mask6_[b]) != net6_[b]) return false;
+    return true;
+}
+
+L2Bridge::Ipv6Key L2Bridge::MakeKey(const uint8_t *addr) {
+    Ipv6Key k;
+    memcpy(&k.hi, addr, 8);
+    memcpy(&k.lo, addr + 8, 8);
+    return k;
+}
+
+// Multicast, broadcast and link-local destinations are never bridged. The
+// broadcast address of the subnet is on the subnet, so it isn't either.
+static bool IsRoutable4(const uint8_t *addr) {
+    return addr[0] != 0 && addr[0] < 224;
+}
+
+static bool IsRoutable6(const uint8_t *addr) {
+    return addr[0] != 0xff && !(addr[0] == 0xfe && (addr[1] & 0xc0) == 0x80);
+}
+
+bool L2Bridge::ReceiveFromEmu(Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t protocol,
+                              const Address &from) {
+    uint8_t hdr[40];
+    if (protocol == kIpv4Protocol && p->CopyData(hdr, 20) == 20) {
+        const uint8_t *src = hdr + 12, *dst = hdr + 16;
+        if (OnSubnet4(src)) {
+            uint32_t key;
+            memcpy(&key, src, 4);
+            neighbors4_[key] = Mac48Address::ConvertFrom(from);
+        }
+        if (!OnSubnet4(dst) && IsRoutable4(dst)) {
+            Send(link_, p, protocol, link_->GetBroadcast());
+            return true;
+        }
+    } else if (protocol == kIpv6Protocol && p->CopyData(hdr, 40) == 40) {
+        const uint8_t *src = hdr + 8, *dst = hdr + 24;
+        if (OnSubnet6(src)) neighbors6_[MakeKey(src)] = Mac48Address::ConvertFrom(from);
+        if (!OnSubnet6(dst) && IsRoutable6(dst)) {
+            Send(link_, p, protocol, link_->GetBroadcast());
+            return true;
+        }
+    }
+    return ToStack(device, p, protocol, from);
+}
+
+bool L2Bridge::ReceiveFromLink(Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t protocol,
+                               const Address &from) {
+    uint8_t hdr[40];
+    if (protocol == kIpv4Protocol && p->CopyData(hdr, 20) == 20 && OnSubnet4(hdr + 16)) {
+        uint32_t key;
+        memcpy(&key, hdr + 16, 4);
+        auto it = neighbors4_.find(key);
+        if (it != neighbors4_.end()) {
+            Send(emu_, p, protocol, it->second);
+            return true;
+        }
+    } else if (protocol == kIpv6Protocol && p->CopyData(hdr, 40) == 40 && OnSubnet6(hdr + 24)) {
+        auto it = neighbors6_.find(MakeKey(hdr + 24));
+        if (it != neighbors6_.end()) {
+            Send(emu_, p, protocol, it->second);
+            return true;
+        }
+    }
+    return ToStack(device, p, protocol, from);
+}
+
+bool L2Bridge::ToStack(Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t protocol,
+                       const Address &from) {
+    tc_->Receive(device, p, protocol, from, device->GetAddress(), NetDevice::PacketType(0));
+    return true;
+}
+
+void L2Bridge::Send(Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t protocol, const Address &to) {
+    tc_->Send(device, ns3::Create<BridgeQueueDiscItem>(p->Copy(), to, protocol));
+}
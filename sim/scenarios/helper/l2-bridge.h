@@ -0,0 +1,66 @@
+#ifndef L2_BRIDGE_H
+#define L2_BRIDGE_H
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "ns3/mac48-address.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/traffic-control-layer.h"
+
+using namespace ns3;
+
+// L2Bridge moves IP packets between the emulated interface of a node (eth0 /
+// eth1) and the node's end of the simulated link, without passing them
+// through the node's IPv4 / IPv6 stack: no route lookup, no TTL handling, no
+// header (de)serialization. Packets are still queued by the queue disc of the
+// outgoing device, and the link still applies its delay and error models.
+//
+// Only unicast packets that are routed across the link are bridged:
+//  - from the emulated interface: packets to a destination outside of the
+//    interface's subnet,
+//  - from the link: packets to a destination on the interface's subnet,
+//    whose MAC address was learned from packets it sent earlier.
+// Everything else (ARP, neighbor discovery, packets for the node itself,
+// packets to a host that didn't send anything yet) takes the normal path
+// through the stack.
+class L2Bridge : public SimpleRefCount<L2Bridge> {
+public:
+    // Takes over the receive callbacks of both devices. Call this after the
+    // stack was installed, and both devices were added to the node.
+    L2Bridge(Ptr<NetDevice> emu, Ptr<NetDevice> link);
+
+private:
+    bool ReceiveFromEmu(Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t protocol,
+                        const Address &from);
+    bool ReceiveFromLink(Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t protocol,
+                         const Address &from);
+    // Hand a packet to the stack, like Node does for packets it receives.
+    bool ToStack(Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t protocol,
+                 const Address &from);
+    void Send(Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t protocol, const Address &to);
+
+    // True if addr (network byte order) is on the subnet of the emulated
+    // interface.
+    bool OnSubnet4(const uint8_t *addr) const;
+    bool OnSubnet6(const uint8_t *addr) const;
+
+    struct Ipv6Key {
+        uint64_t hi, lo;
+        bool operator==(const Ipv6Key &o) const { return hi == o.hi && lo == o.lo; }
+    };
+    struct Ipv6KeyHash {
+        size_t operator()(const Ipv6Key &k) const { return k.hi * 31 + k.lo; }
+    };
+    static Ipv6Key MakeKey(const uint8_t *addr);
+
+    Ptr<NetDevice> emu_, link_;
+    Ptr<TrafficControlLayer> tc_;
+    uint32_t net4_, mask4_;         // host byte order
+    uint8_t net6_[16], mask6_[16];
+    std::unordered_map<uint32_t, Mac48Address> neighbors4_;
+    std::unordered_map<Ipv6Key, Mac48Address, Ipv6KeyHash> neighbors6_;
+};
+
+#endif /* L2_BRIDGE_H */
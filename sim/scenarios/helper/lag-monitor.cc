@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include "lag-monitor.h"
+#include "event-log.h"
+
+#include "ns3/double.h"
+#include "ns3/global-value.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+
+using namespace ns3;
+using namespace std;
+
+static GlobalValue g_lagThreshold = GlobalValue("LagThreshold",
+    "The simulator counts as overloaded while events run later than this",
+    TimeValue(MilliSeconds(1)), MakeTimeChecker());
+
+static GlobalValue g_lagMax = GlobalValue("LagMax",
+    "Results are not trustworthy if an event ran later than this",
+    TimeValue(MilliSeconds(20)), MakeTimeChecker());
+
+static GlobalValue g_lagOverloadBudget = GlobalValue("LagOverloadBudget",
+    "Results are not trustworthy if the simulator was overloaded for more than this percentage of the run",
+    DoubleValue(1), MakeDoubleChecker<double>(0, 100));
+
+const Time LagMonitor::kProbeInterval = MilliSeconds(1);
+
+LagMonitor &LagMonitor::Get() {
+    static LagMonitor monitor;
+    return monitor;
+}
+
+LagMonitor::LagMonitor()
+    : overload_budget_(0), reported_(false), overloaded_(false), probes_(0) {
+    memset(buckets_, 0, sizeof(buckets_));
+}
+
+void LagMonitor::Start() {
+    impl_ = DynamicCast<RealtimeSimulatorImpl>(Simulator::GetImplementation());
+    if (!impl_) return;
+
+    TimeValue threshold, max_allowed;
+    g_lagThreshold.GetValue(threshold);
+    g_lagMax.GetValue(max_allowed);
+    threshold_ = threshold.Get();
+    max_allowed_ = max_allowed.Get();
+    DoubleValue budget;
+    g_lagOverloadBudget.GetValue(budget);
+    overload_budget_ = budget.Get();
+
+    CounterRegistry &registry = CounterRegistry::Get();
+    lag_histogram_ = registry.RegisterHistogram("sim.lag.us");
+    max_lag_gauge_ = registry.RegisterGauge("sim.max_lag.us");
+    overloaded_counter_ = registry.RegisterCounter("sim.overloaded.us");
+
+    // The realtime clock only starts with Simulator::Run(), so the first probe
+    // just takes the starting time.
+    Simulator::Schedule(Seconds(0), &LagMonitor::Probe, this);
+}
+
+void LagMonitor::Probe() {
+    const Time now = impl_->RealtimeNow();
+    const Time lag = max(now - Simulator::Now(), Seconds(0));
+    if (probes_ == 0) start_ = now;
+    probes_++;
+
+    const uint64_t lag_us = lag.GetMicroSeconds();
+    uint32_t bucket = lag_us == 0 ? 0 : 64 - __builtin_clzll(lag_us);
+    if (bucket >= kHistogramBuckets) bucket = kHistogramBuckets - 1;
+    buckets_[bucket]++;
+    lag_histogram_.Record(lag_us);
+    if (lag > max_lag_) {
+        max_lag_ = lag;
+        max_lag_at_ = Simulator::Now();
+        max_lag_gauge_.Set(lag_us);
+    }
+
+    // Attribute the wall clock time since the last probe to the state that
+    // this probe observes.
+    if (lag > threshold_) {
+        if (probes_ > 1) {
+            overloaded_time_ += now - last_;
+            overloaded_counter_.Add((now - last_).GetMicroSeconds());
+        }
+        if (!overloaded_) {
+            overloaded_ = true;
+            overload_start_ = now;
+            EventRecord r = EventLog::Record(kEventOverloaded);
+            r.arg[0] = lag_us;
+            EventLog::Get().Log(r);
+        }
+    } else if (overloaded_) {
+        overloaded_ = false;
+        EventRecord r = EventLog::Record(kEventOverloadEnd);
+        r.arg[0] = (now - overload_start_).GetMicroSeconds();
+        EventLog::Get().Log(r);
+    }
+    last_ = now;
+
+    Simulator::Schedule(kProbeInterval, &LagMonitor::Probe, this);
+}
+
+uint64_t LagMonitor::Quantile(double q) const {
+    return HistogramQuantile(probes_, q, [this](uint32_t i) { return buckets_[i]; });
+}
+
+bool LagMonitor::Report() {
+    if (!impl_ || probes_ < 2 || reported_) return true;
+    reported_ = true;
+
+    const Time total = last_ - start_;
+    const double overloaded_pct =
+        total.IsStrictlyPositive() ? overloaded_time_.GetSeconds() / total.GetSeconds() * 100 : 0;
+    cout << "Simulator lag: " << probes_ << " probes, p50 < " << Quantile(0.5)
+         << "us, p99 < " << Quantile(0.99) << "us, p99.9 < " << Quantile(0.999)
+         << "us, max " << max_lag_.GetMicroSeconds() << "us (at "
+         << max_lag_at_.GetSeconds() << "s)" << endl;
+    cout << "Lag histogram (us):";
+    for (uint32_t i = 0; i < kHistogramBuckets; i++) {
+        if (buckets_[i] == 0) continue;
+        cout << " <" << (i == 0 ? 1 : 1ull << i) << ": " << buckets_[i];
+    }
+    cout << endl;
+    cout << "Simulator overloaded (lag > " << threshold_.GetMicroSeconds() << "us) for "
+         << overloaded_time_.GetSeconds() << "s of " << total.GetSeconds() << "s ("
+         << fixed << setprecision(2) << overloaded_pct << "%)" << defaultfloat << endl;
+
+    const bool too_late = max_lag_ > max_allowed_;
+    const bool too_long = overloaded_pct > overload_budget_;
+    if (!too_late && !too_long) {
+        cout << "Verdict: TRUSTWORTHY, the simulator kept up with the wall clock" << endl;
+        return true;
+    }
+    cout << "Verdict: NOT TRUSTWORTHY, the simulator fell behind the wall clock:";
+    if (too_late) cout << " max lag above " << max_allowed_.GetMicroSeconds() << "us";
+    if (too_late && too_long) cout << ",";
+    if (too_long) cout << " overloaded for more than " << overload_budget_ << "% of the run";
+    cout << ". Part of the delay and loss was caused by the simulator, not by the scenario."
+         << endl;
+    return false;
+}
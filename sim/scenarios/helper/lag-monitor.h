@@ -0,0 +1,64 @@
+#ifndef LAG_MONITOR_H
+#define LAG_MONITOR_H
+
+#include <cstdint>
+
+#include "ns3/nstime.h"
+#include "ns3/realtime-simulator-impl.h"
+#include "counters.h"
+
+using namespace ns3;
+
+// LagMonitor measures how far the RealtimeSimulatorImpl falls behind the
+// wall clock. When the simulator can't keep up, events (and the packets they
+// carry) are processed late, which adds delay and loss that have nothing to
+// do with the scenario.
+//
+// A probe event runs every millisecond of simulated time, and records how
+// late it runs: the wall clock time minus the simulation time. Since events
+// are processed in order, the probe's lag is the lag of all events around it.
+// The simulator counts as overloaded while the lag exceeds LagThreshold.
+//
+// At the end of the run, Report() prints the lag distribution, its maximum,
+// the fraction of time the simulator was overloaded, and a verdict: results
+// are trustworthy if the simulator was overloaded for no more than
+// LagOverloadBudget percent of the run, and the lag never exceeded LagMax.
+class LagMonitor {
+public:
+    static LagMonitor &Get();
+
+    // Schedule the first probe. Does nothing unless the simulator is a
+    // RealtimeSimulatorImpl.
+    void Start();
+    // Print the statistics and the verdict. Returns true if the results are
+    // trustworthy.
+    bool Report();
+
+private:
+    LagMonitor();
+    LagMonitor(const LagMonitor &) = delete;
+    LagMonitor &operator=(const LagMonitor &) = delete;
+
+    void Probe();
+    // Upper bound of the bucket that contains the q-quantile, in us.
+    uint64_t Quantile(double q) const;
+
+    static const Time kProbeInterval;
+
+    Ptr<RealtimeSimulatorImpl> impl_;
+    Time threshold_, max_allowed_;
+    double overload_budget_; // in percent
+    bool reported_;
+
+    Time start_, last_;   // wall clock
+    Time max_lag_, max_lag_at_;
+    Time overloaded_time_, overload_start_;
+    bool overloaded_;
+    uint64_t probes_;
+    uint64_t buckets_[kHistogramBuckets]; // see counters-layout.h, in us
+
+    Histogram lag_histogram_;
+    Counter max_lag_gauge_, overloaded_counter_;
+};
+
+#endif /* LAG_MONITOR_H */
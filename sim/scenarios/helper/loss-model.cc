@@ -0,0 +1,139 @@
+#include <cmath>
+#include <fstream>
+
+#include "loss-model.h"
+
+#include "ns3/abort.h"
+
+using namespace ns3;
+using namespace std;
+
+LossModel::LossModel(const string &stream) : rng_(stream), started_(false), gap_(0) {}
+
+double LossModel::Uniform() {
+    return rng_.Uniform();
+}
+
+uint64_t LossModel::SampleGap(double p) {
+    if (p >= 1) return 0;
+    if (p <= 0) return kNever;
+    const double gap = floor(log(Uniform()) / log1p(-p));
+    return gap >= (double)kNever ? kNever : (uint64_t)gap;
+}
+
+BernoulliLoss::BernoulliLoss(double rate, const string &stream) : LossModel(stream), p_(rate / 100) {}
+
+uint64_t BernoulliLoss::NextGap() {
+    return SampleGap(p_);
+}
+
+GilbertElliottLoss::GilbertElliottLoss(double p, double r, double good, double bad, const string &stream)
+    : LossModel(stream), exit_{p / 100, r / 100}, loss_{good / 100, bad / 100}, state_(0) {
+    run_ = SampleRun(state_);
+}
+
+uint64_t GilbertElliottLoss::SampleRun(uint32_t state) {
+    const uint64_t stay = SampleGap(exit_[state]);
+    return stay == kNever ? kNever : stay + 1;
+}
+
+uint64_t GilbertElliottLoss::NextGap() {
+    // Losses within a visit of a state are Bernoulli trials. Since they are
+    // memoryless, a loss sampled past the end of the visit is discarded, and
+    // sampled again in the next state.
+    uint64_t gap = 0;
+    while (true) {
+        if (run_ == 0) {
+            state_ ^= 1;
+            run_ = SampleRun(state_);
+        }
+        const uint64_t until = SampleGap(loss_[state_]);
+        if (until < run_) {
+            if (run_ != kNever) run_ -= until + 1;
+            return gap + until;
+        }
+        if (run_ == kNever) return kNever;
+        gap += run_;
+        run_ = 0;
+    }
+}
+
+Markov4Loss::Markov4Loss(double p13, double p31, double p32, double p23, double p14, const string &stream)
+    : LossModel(stream), p_{{0, 0, p13 / 100, p14 / 100}, {0, 0, p23 / 100, 0}, {p31 / 100, p32 / 100, 0, 0}, {1, 0, 0, 0}},
+      state_(0) {
+    for (int i = 0; i < 4; i++) {
+        double leave = 0;
+        for (int j = 0; j < 4; j++) leave += p_[i][j];
+        NS_ABORT_MSG_IF(leave > 1, "Invalid markov4 probabilities: the transitions out of state " << i + 1
+                                   << " add up to more than 100%");
+    }
+    const uint64_t stay = SampleGap(p_[0][2] + p_[0][3]);
+    run_ = stay == kNever ? kNever : stay + 1;
+}
+
+void Markov4Loss::Transition() {
+    const double *p = p_[state_];
+    double leave = 0;
+    for (int j = 0; j < 4; j++) leave += p[j];
+    // Pick the next state in proportion to the transition probabilities.
+    double x = Uniform() * leave;
+    uint32_t next = state_;
+    for (uint32_t j = 0; j < 4; j++) {
+        if (p[j] == 0) continue;
+        next = j;
+        if (x <= p[j]) break;
+        x -= p[j];
+    }
+    state_ = next;
+    leave = 0;
+    for (int j = 0; j < 4; j++) leave += p_[state_][j];
+    const uint64_t stay = SampleGap(leave);
+    run_ = stay == kNever ? kNever : stay + 1;
+}
+
+uint64_t Markov4Loss::NextGap() {
+    uint64_t gap = 0;
+    while (true) {
+        if (run_ == 0) Transition();
+        if (state_ >= 2) {
+            // Every packet in states 3 and 4 is lost.
+            if (run_ != kNever) run_--;
+            return gap;
+        }
+        if (run_ == kNever) return kNever;
+        gap += run_;
+        run_ = 0;
+    }
+}
+
+TraceLoss::TraceLoss(const string &filename) : LossModel("losstrace"), tail_(0), next_(0), repeated_(false) {
+    ifstream in(filename);
+    NS_ABORT_MSG_IF(!in, "Can't read loss trace " << filename);
+    string line;
+    uint64_t passed = 0;
+    while (getline(in, line)) {
+        if (!line.empty() && line[0] == '#') continue;
+        for (char c : line) {
+            if (c == '0') {
+                passed++;
+            } else if (c == '1') {
+                gaps_.push_back(passed);
+                passed = 0;
+            } else {
+                NS_ABORT_MSG_IF(!isspace((unsigned char)c), "Invalid character in loss trace " << filename << ": " << c);
+            }
+        }
+    }
+    tail_ = passed;
+}
+
+uint64_t TraceLoss::NextGap() {
+    if (gaps_.empty()) return kNever;
+    uint64_t gap = gaps_[next_];
+    if (next_ == 0 && repeated_) gap += tail_;
+    if (++next_ == gaps_.size()) {
+        next_ = 0;
+        repeated_ = true;
+    }
+    return gap;
+}
@@ -0,0 +1,128 @@
+#ifndef LOSS_MODEL_H
+#define LOSS_MODEL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ns3/simple-ref-count.h"
+#include "random-source.h"
+
+using namespace ns3;
+
+// A LossModel decides which packets of a stream are lost. Instead of
+// drawing a random number for every packet, a model samples the number of
+// packets that pass before the next loss (geometrically, for the random
+// models), so that a run at a low loss rate costs a few random numbers per
+// loss instead of one per packet.
+class LossModel : public SimpleRefCount<LossModel> {
+public:
+    virtual ~LossModel() {}
+
+    // Returns true if the next packet is lost.
+    bool Next() {
+        if (!started_) {
+            gap_ = NextGap();
+            started_ = true;
+        }
+        if (gap_ > 0) {
+            gap_--;
+            return false;
+        }
+        gap_ = NextGap();
+        return true;
+    }
+    // The state of the model, for logging.
+    virtual uint32_t GetState() const { return 0; }
+
+protected:
+    static const uint64_t kNever = UINT64_MAX;
+
+    // stream names the RandomStream of the model.
+    explicit LossModel(const std::string &stream);
+    // The number of packets that pass before the next loss, or kNever.
+    virtual uint64_t NextGap() = 0;
+
+    // The number of failures before the first success of Bernoulli trials
+    // with success probability p, or kNever.
+    uint64_t SampleGap(double p);
+    // A number in (0, 1].
+    double Uniform();
+
+private:
+    RandomStream rng_;
+    bool started_;
+    uint64_t gap_;
+};
+
+// Loses every packet with probability rate (in percent), independently.
+class BernoulliLoss : public LossModel {
+public:
+    BernoulliLoss(double rate, const std::string &stream);
+
+private:
+    uint64_t NextGap();
+
+    double p_;
+};
+
+// The Gilbert-Elliott model: a good and a bad state, that lose packets with
+// probability good and bad (in percent). The model moves from the good to
+// the bad state with probability p, and back with probability r, after
+// every packet.
+class GilbertElliottLoss : public LossModel {
+public:
+    GilbertElliottLoss(double p, double r, double good, double bad, const std::string &stream);
+    uint32_t GetState() const { return state_; }
+
+private:
+    uint64_t NextGap();
+    // The number of packets in a visit of state, at least 1.
+    uint64_t SampleRun(uint32_t state);
+
+    double exit_[2], loss_[2];
+    uint32_t state_; // 0: good, 1: bad
+    uint64_t run_;   // packets left in the current state
+};
+
+// The four-state Markov model of netem (loss state p13 p31 p32 p23 p14):
+//   1: packets pass (gap),        goes to 3 with p13, to 4 with p14,
+//   2: packets pass (burst),      goes to 3 with p23,
+//   3: packets are lost (burst),  goes to 1 with p31, to 2 with p32,
+//   4: a packet is lost (isolated), goes to 1.
+// Probabilities are in percent. The state after the transition decides the
+// fate of a packet.
+class Markov4Loss : public LossModel {
+public:
+    Markov4Loss(double p13, double p31, double p32, double p23, double p14, const std::string &stream);
+    uint32_t GetState() const { return state_ + 1; }
+
+private:
+    uint64_t NextGap();
+    // Move to the next state, and sample how many packets stay in it.
+    void Transition();
+
+    double p_[4][4]; // transition probabilities
+    uint32_t state_; // 0-based
+    uint64_t run_;   // packets left in the current state
+};
+
+// Replays a recorded loss pattern, from a file with one character per
+// packet: 0 for a packet that passes, 1 for a lost one. Whitespace and
+// lines starting with # are ignored. The pattern repeats.
+class TraceLoss : public LossModel {
+public:
+    explicit TraceLoss(const std::string &filename);
+
+private:
+    uint64_t NextGap();
+
+    // The packets that pass before each loss. The packets after the last
+    // loss are added to the first gap of the next round.
+    std::vector<uint64_t> gaps_;
+    uint64_t tail_;
+    size_t next_;
+    bool repeated_;
+};
+
+#endif /* LOSS_MODEL_H */
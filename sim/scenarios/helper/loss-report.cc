@@ -0,0 +1,170 @@
+#include <csignal>
+#include <fstream>
+#include <iostream>
+
+#include "loss-report.h"
+#include "emu-fd-net-device.h"
+#include "mmsg-net-device.h"
+#include "packet-ring-net-device.h"
+
+#include "ns3/fd-net-device.h"
+#include "ns3/simulator.h"
+
+using namespace ns3;
+using namespace std;
+
+static const Time kUpdateInterval = Seconds(1);
+
+const char *const LossReport::kPointNames[kPoints] = {
+    "interface", "socket", "device_rx", "ip_stack", "queue_disc", "device_queue", "error_model", "device_tx",
+};
+
+atomic<bool> LossReport::report_requested_(false);
+
+LossReport &LossReport::Get() {
+    static LossReport report;
+    return report;
+}
+
+LossReport::LossReport() : started_(false) {}
+
+LossReport::Direction &LossReport::GetDirectionEntry(const string &name) {
+    auto it = directions_.find(name);
+    if (it != directions_.end()) return it->second;
+    Direction &d = directions_[name];
+    for (int i = 0; i < kPoints; i++) {
+        d.drops[i] = 0;
+        d.gauges[i] = CounterRegistry::Get().RegisterGauge(name + ".loss." + kPointNames[i] + ".packets");
+    }
+    d.socket_known = true;
+    return d;
+}
+
+void LossReport::AddInterface(const string &name, Ptr<NetDevice> device, const string &rx_direction,
+                              const string &tx_direction) {
+    GetDirectionEntry(rx_direction);
+    GetDirectionEntry(tx_direction);
+    interfaces_.push_back({name, device, rx_direction, tx_direction, 0});
+    // The MmsgNetDevice counts its TX drops itself.
+    if (DynamicCast<FdNetDevice>(device))
+        device->TraceConnectWithoutContext("MacTxDrop", MakeBoundCallback(&LossReport::CountTxDrop, &tx_drops_[tx_direction]));
+}
+
+void LossReport::AddNode(Ptr<Node> node) {
+    if (Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol>())
+        ipv4->TraceConnectWithoutContext("Drop", MakeCallback(&LossReport::CountIpv4Drop, this));
+    if (Ptr<Ipv6L3Protocol> ipv6 = node->GetObject<Ipv6L3Protocol>())
+        ipv6->TraceConnectWithoutContext("Drop", MakeCallback(&LossReport::CountIpv6Drop, this));
+}
+
+void LossReport::Start() {
+    for (Interface &iface : interfaces_) iface.rx_dropped_start = ReadRxDropped(iface.name);
+    signal(SIGUSR1, &LossReport::OnSignal);
+    started_ = true;
+    Simulator::Schedule(kUpdateInterval, &LossReport::Update, this);
+}
+
+void LossReport::OnSignal(int signum) {
+    // Print on the simulator thread, see Update().
+    report_requested_.store(true);
+}
+
+uint64_t LossReport::ReadRxDropped(const string &interface) {
+    ifstream f("/sys/class/net/" + interface + "/statistics/rx_dropped");
+    uint64_t n = 0;
+    f >> n;
+    return n;
+}
+
+void LossReport::CountTxDrop(uint64_t *drops, Ptr<const Packet> p) {
+    (*drops)++;
+}
+
+const char *LossReport::GetDirection(const uint8_t *dst, bool ipv6) {
+    // Clients are on subnet n < 100, servers on subnet n + 100, see
+    // findInterfaces(). The link is subnet 50.
+    const uint32_t subnet = ipv6 ? (dst[6] << 8 | dst[7]) : dst[2];
+    const uint32_t server_start = ipv6 ? 0x100 : 100;
+    const uint32_t link = ipv6 ? 0x50 : 50;
+    if (subnet == link) return nullptr;
+    return subnet >= server_start ? "to_server" : "to_client";
+}
+
+void LossReport::CountIpv4Drop(const Ipv4Header &header, Ptr<const Packet> p, Ipv4L3Protocol::DropReason reason,
+                               Ptr<Ipv4> ipv4, uint32_t interface) {
+    uint8_t dst[4];
+    header.GetDestination().Serialize(dst);
+    if (const char *direction = GetDirection(dst, false)) ip_drops_[direction]++;
+}
+
+void LossReport::CountIpv6Drop(const Ipv6Header &header, Ptr<const Packet> p, Ipv6L3Protocol::DropReason reason,
+                               Ptr<Ipv6> ipv6, uint32_t interface) {
+    uint8_t dst[16];
+    header.GetDestination().Serialize(dst);
+    if (const char *direction = GetDirection(dst, true)) ip_drops_[direction]++;
+}
+
+void LossReport::Collect() {
+    for (auto &entry : directions_) {
+        Direction &d = entry.second;
+        const DirectionCounters &c = CounterRegistry::Get().GetDirection(entry.first);
+        for (int i = 0; i < kPoints; i++) d.drops[i] = 0;
+        d.socket_known = true;
+        d.drops[kIpStack] = ip_drops_[entry.first];
+        d.drops[kQueueDisc] = c.queue_dropped_packets.Get();
+        d.drops[kDeviceQueue] = c.device_queue_dropped_packets.Get();
+        d.drops[kErrorModel] = c.dropped_packets.Get();
+        d.drops[kDeviceTx] = tx_drops_[entry.first];
+    }
+    for (Interface &iface : interfaces_) {
+        Direction &rx = directions_[iface.rx_direction];
+        Direction &tx = directions_[iface.tx_direction];
+        rx.drops[kInterface] += ReadRxDropped(iface.name) - iface.rx_dropped_start;
+        if (Ptr<MmsgNetDevice> mmsg = DynamicCast<MmsgNetDevice>(iface.device)) {
+            rx.drops[kSocket] += mmsg->GetKernelDrops();
+            rx.drops[kDeviceRx] += mmsg->GetRxRingDrops();
+            tx.drops[kDeviceTx] += mmsg->GetTxDrops();
+        } else if (Ptr<PacketRingNetDevice> ring = DynamicCast<PacketRingNetDevice>(iface.device)) {
+            rx.drops[kSocket] += ring->GetKernelDrops();
+        } else if (Ptr<EmuFdNetDevice> emu = DynamicCast<EmuFdNetDevice>(iface.device)) {
+            rx.drops[kSocket] += emu->GetKernelDrops();
+        } else {
+            rx.socket_known = false;
+        }
+    }
+    for (auto &entry : directions_)
+        for (int i = 0; i < kPoints; i++) entry.second.gauges[i].Set(entry.second.drops[i]);
+}
+
+void LossReport::Update() {
+    Collect();
+    if (report_requested_.exchange(false)) Report();
+    Simulator::Schedule(kUpdateInterval, &LossReport::Update, this);
+}
+
+bool LossReport::Report() {
+    if (!started_) return true;
+    Collect();
+    bool explained = true;
+    cout << "Loss report at " << Simulator::Now().GetSeconds() << "s (packets):" << endl;
+    for (const auto &entry : directions_) {
+        const Direction &d = entry.second;
+        uint64_t requested = 0, unexplained = 0;
+        cout << "  " << entry.first << ":";
+        for (int i = 0; i < kPoints; i++) {
+            cout << " " << kPointNames[i] << "=";
+            if (i == kSocket && !d.socket_known && d.drops[i] == 0) cout << "n/a";
+            else cout << d.drops[i];
+            if (i == kQueueDisc || i == kErrorModel) requested += d.drops[i];
+            else unexplained += d.drops[i];
+        }
+        cout << endl;
+        if (!d.socket_known)
+            cout << "  NOTE: socket drops " << entry.first << " are unknown, and not covered by this report" << endl;
+        if (unexplained == 0) continue;
+        explained = false;
+        cout << "  WARNING: " << unexplained << " packets " << entry.first
+             << " were lost outside the scenario (" << requested << " dropped by the scenario)" << endl;
+    }
+    return explained;
+}
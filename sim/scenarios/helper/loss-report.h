@@ -0,0 +1,103 @@
+#ifndef LOSS_REPORT_H
+#define LOSS_REPORT_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ns3/internet-module.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "counters.h"
+
+using namespace ns3;
+
+// LossReport attributes every packet lost between the endpoints to the place
+// where it was lost, per direction (to_client, to_server):
+//   interface:    the kernel dropped it on the interface (rx_dropped),
+//   socket:       the kernel dropped it because the raw socket's buffer was
+//                 full (PACKET_STATISTICS),
+//   device rx:    the simulator's device couldn't take it (mmsg RX ring),
+//   ip stack:     a simulated node dropped it (no route, TTL, ...),
+//   queue disc:   the bottleneck queue was full,
+//   device queue: the link device's own queue was full,
+//   error model:  the scenario's error model dropped it,
+//   device tx:    it couldn't be written to the interface.
+// Only queue disc and error model drops are part of the scenario. Every
+// other drop is flagged as unexplained.
+//
+// The breakdown is exported to the counters file (<direction>.loss.*), and
+// printed at the end of the run, or when the simulator receives SIGUSR1.
+class LossReport {
+public:
+    static LossReport &Get();
+
+    // Track the drops of an interface to an endpoint. Packets arriving on it
+    // travel in rx_direction, packets sent on it in tx_direction.
+    void AddInterface(const std::string &name, Ptr<NetDevice> device, const std::string &rx_direction,
+                      const std::string &tx_direction);
+    // Track the drops in the IP stack of a node.
+    void AddNode(Ptr<Node> node);
+    // Start the periodic update of the counters.
+    void Start();
+    // Print the breakdown. Returns true if there were no unexplained drops.
+    bool Report();
+
+private:
+    enum Point {
+        kInterface,
+        kSocket,
+        kDeviceRx,
+        kIpStack,
+        kQueueDisc,
+        kDeviceQueue,
+        kErrorModel,
+        kDeviceTx,
+        kPoints
+    };
+
+    struct Interface {
+        std::string name;
+        Ptr<NetDevice> device;
+        std::string rx_direction, tx_direction;
+        uint64_t rx_dropped_start; // the interface's rx_dropped at Start()
+    };
+
+    struct Direction {
+        uint64_t drops[kPoints];
+        bool socket_known; // false if an interface can't report socket drops
+        Counter gauges[kPoints];
+    };
+
+    LossReport();
+    LossReport(const LossReport &) = delete;
+    LossReport &operator=(const LossReport &) = delete;
+
+    static const char *const kPointNames[kPoints];
+    static void OnSignal(int signum);
+    static uint64_t ReadRxDropped(const std::string &interface);
+    // The direction of a packet to dst, or nullptr for the link's addresses.
+    static const char *GetDirection(const uint8_t *dst, bool ipv6);
+    static void CountTxDrop(uint64_t *drops, Ptr<const Packet> p);
+
+    Direction &GetDirectionEntry(const std::string &name);
+    // Read the drop counts of all points, and update the gauges.
+    void Collect();
+    void Update();
+    void CountIpv4Drop(const Ipv4Header &header, Ptr<const Packet> p, Ipv4L3Protocol::DropReason reason,
+                       Ptr<Ipv4> ipv4, uint32_t interface);
+    void CountIpv6Drop(const Ipv6Header &header, Ptr<const Packet> p, Ipv6L3Protocol::DropReason reason,
+                       Ptr<Ipv6> ipv6, uint32_t interface);
+
+    static std::atomic<bool> report_requested_;
+
+    std::vector<Interface> interfaces_;
+    std::map<std::string, Direction> directions_;
+    // Drops counted by trace sources, by direction.
+    std::map<std::string, uint64_t> tx_drops_, ip_drops_;
+    bool started_;
+};
+
+#endif /* LOSS_REPORT_H */
@@ -0,0 +1,391 @@
+// The ns-3 headers go first: <linux/if_packet.h> defines PACKET_HOST etc.
+// as macros, which clash with NetDevice::PacketType.
+#include "mmsg-net-device.h"
+#include "thread-placement.h"
+
+#include "ns3/abort.h"
+#include "ns3/ethernet-header.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace ns3;
+using namespace std;
+
+NS_OBJECT_ENSURE_REGISTERED(MmsgNetDevice);
+
+TypeId MmsgNetDevice::GetTypeId(void) {
+    static TypeId tid = TypeId("MmsgNetDevice")
+        .SetParent<NetDevice>()
+        .AddConstructor<MmsgNetDevice>()
+        .AddAttribute("Address",
+                      "The MAC address of this device",
+                      Mac48AddressValue(Mac48Address("ff:ff:ff:ff:ff:ff")),
+                      MakeMac48AddressAccessor(&MmsgNetDevice::address_),
+                      MakeMac48AddressChecker())
+        .AddAttribute("RxBatch",
+                      "Maximum number of frames received per recvmmsg() call",
+                      UintegerValue(64),
+                      MakeUintegerAccessor(&MmsgNetDevice::rx_batch_),
+                      MakeUintegerChecker<uint32_t>(1, 1024))
+        .AddAttribute("TxBatch",
+                      "Maximum number of frames sent per sendmmsg() call",
+                      UintegerValue(64),
+                      MakeUintegerAccessor(&MmsgNetDevice::tx_batch_),
+                      MakeUintegerChecker<uint32_t>(1, 1024))
+        .AddAttribute("RxRingSize",
+                      "Number of frames that the RX ring between the reader thread and the simulator holds",
+                      UintegerValue(8192),
+                      MakeUintegerAccessor(&MmsgNetDevice::rx_ring_size_),
+                      MakeUintegerChecker<uint32_t>(1))
+        .AddAttribute("TxRingSize",
+                      "Number of frames that the TX ring between the simulator and the writer thread holds",
+                      UintegerValue(8192),
+                      MakeUintegerAccessor(&MmsgNetDevice::tx_ring_size_),
+                      MakeUintegerChecker<uint32_t>(1));
+    return tid;
+}
+
+MmsgNetDevice::MmsgNetDevice()
+    : ifindex_(0), mtu_(1500), link_up_(false), rx_batch_(64), tx_batch_(64),
+      rx_ring_size_(8192), tx_ring_size_(8192), rx_cpu_(-1), tx_cpu_(-1), fd_(-1),
+      rx_stop_fd_(-1), tx_wake_fd_(-1), rx_drain_scheduled_(false), tx_idle_(false),
+      stop_(false), rx_dropped_total_(0), tx_dropped_total_(0), kernel_dropped_(0) {}
+
+MmsgNetDevice::~MmsgNetDevice() {
+    Stop();
+}
+
+void MmsgNetDevice::Open(const string &interface) {
+    interface_ = interface;
+    fd_ = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    NS_ABORT_MSG_IF(fd_ < 0, "Can't create packet socket: " << strerror(errno));
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, interface.c_str(), IFNAMSIZ - 1);
+    NS_ABORT_MSG_IF(ioctl(fd_, SIOCGIFINDEX, &ifr) < 0, "Can't find interface " << interface);
+    const int ifindex = ifr.ifr_ifindex;
+    NS_ABORT_MSG_IF(ioctl(fd_, SIOCGIFMTU, &ifr) < 0, "Can't get the MTU of " << interface);
+    mtu_ = ifr.ifr_mtu;
+
+    // Absorb bursts that arrive while the reader is busy.
+    int rcvbuf = 4 << 20;
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    int one = 1;
+    setsockopt(fd_, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one));
+
+    struct sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = ifindex;
+    NS_ABORT_MSG_IF(bind(fd_, (struct sockaddr *)&addr, sizeof(addr)) < 0,
+                    "Can't bind to " << interface << ": " << strerror(errno));
+
+    rx_stop_fd_ = eventfd(0, 0);
+    tx_wake_fd_ = eventfd(0, 0);
+    NS_ABORT_MSG_IF(rx_stop_fd_ < 0 || tx_wake_fd_ < 0, "Can't create eventfd: " << strerror(errno));
+
+    // Ethernet header, a VLAN tag, and the FCS, the same as FdNetDevice.
+    rx_ring_.reset(new FrameRing(rx_ring_size_, mtu_ + 22));
+    tx_ring_.reset(new FrameRing(tx_ring_size_, mtu_ + 22));
+    CounterRegistry &registry = CounterRegistry::Get();
+    rx_dropped_ = registry.RegisterCounter(interface + ".rx_ring_dropped.packets");
+    tx_dropped_ = registry.RegisterCounter(interface + ".tx_ring_dropped.packets");
+}
+
+void MmsgNetDevice::SetCpus(int rx_cpu, int tx_cpu) {
+    rx_cpu_ = rx_cpu;
+    tx_cpu_ = tx_cpu;
+}
+
+void MmsgNetDevice::SetIngressFilter(Callback<bool, uint8_t *, uint32_t> filter) {
+    ingress_filter_ = filter;
+}
+
+uint64_t MmsgNetDevice::GetKernelDrops() {
+    // Reading the statistics resets them.
+    tpacket_stats stats;
+    socklen_t len = sizeof(stats);
+    if (fd_ >= 0 && getsockopt(fd_, SOL_PACKET, PACKET_STATISTICS, &stats, &len) == 0)
+        kernel_dropped_ += stats.tp_drops;
+    return kernel_dropped_;
+}
+
+uint64_t MmsgNetDevice::GetRxRingDrops() const {
+    return rx_dropped_total_.load(memory_order_relaxed);
+}
+
+uint64_t MmsgNetDevice::GetTxDrops() const {
+    return tx_dropped_total_.load(memory_order_relaxed);
+}
+
+void MmsgNetDevice::DoInitialize(void) {
+    NS_ABORT_MSG_IF(fd_ < 0, "MmsgNetDevice was not opened");
+    reader_ = thread(&MmsgNetDevice::ReaderLoop, this);
+    writer_ = thread(&MmsgNetDevice::WriterLoop, this);
+    link_up_ = true;
+    link_change_callbacks_();
+    NetDevice::DoInitialize();
+}
+
+void MmsgNetDevice::Stop() {
+    if (stop_.exchange(true)) return;
+    const uint64_t one = 1;
+    if (reader_.joinable()) {
+        if (write(rx_stop_fd_, &one, sizeof(one)) < 0) {}
+        reader_.join();
+    }
+    if (writer_.joinable()) {
+        if (write(tx_wake_fd_, &one, sizeof(one)) < 0) {}
+        writer_.join();
+    }
+    if (fd_ >= 0) close(fd_);
+    if (rx_stop_fd_ >= 0) close(rx_stop_fd_);
+    if (tx_wake_fd_ >= 0) close(tx_wake_fd_);
+    fd_ = rx_stop_fd_ = tx_wake_fd_ = -1;
+    if (rx_dropped_total_.load() > 0 || tx_dropped_total_.load() > 0)
+        cout << interface_ << ": " << rx_dropped_total_.load() << " frames dropped (RX ring full), "
+             << tx_dropped_total_.load() << " frames not sent (TX ring full or refused)" << endl;
+}
+
+void MmsgNetDevice::DoDispose(void) {
+    Stop();
+    node_ = nullptr;
+    rx_callback_.Nullify();
+    promisc_rx_callback_.Nullify();
+    NetDevice::DoDispose();
+}
+
+void MmsgNetDevice::ReaderLoop() {
+    ThreadPlacement::Get().PlaceCurrentThread(ThreadPlacement::kIo, interface_ + " reader", rx_cpu_);
+    vector<mmsghdr> msgs(rx_batch_);
+    vector<iovec> iovs(rx_batch_);
+    // Frames that arrive while the ring is full are read into here, and
+    // dropped.
+    vector<uint8_t> discard(rx_ring_->GetFrameSize());
+    const uint32_t frame_size = rx_ring_->GetFrameSize();
+    pollfd fds[2] = {{fd_, POLLIN, 0}, {rx_stop_fd_, POLLIN, 0}};
+
+    while (!stop_.load(memory_order_relaxed)) {
+        if (poll(fds, 2, -1) < 0 && errno != EINTR) break;
+        if (fds[1].revents) break;
+        // Read until the socket is empty.
+        while (true) {
+            const uint32_t writable = rx_ring_->WritableCount();
+            const uint32_t n = writable > 0 ? min(rx_batch_, writable) : 1;
+            for (uint32_t i = 0; i < n; i++) {
+                iovs[i].iov_base = writable > 0 ? rx_ring_->WriteSlot(i) : discard.data();
+                iovs[i].iov_len = frame_size;
+                memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            const int r = recvmmsg(fd_, msgs.data(), n, MSG_DONTWAIT, nullptr);
+            if (r <= 0) break;
+            if (writable == 0) {
+                rx_dropped_.Add(r);
+                rx_dropped_total_.fetch_add(r, memory_order_relaxed);
+                continue;
+            }
+            // Filtered frames keep their slot, with length 0. Only the
+            // simulator can release them.
+            for (int i = 0; i < r; i++) {
+                uint32_t len = msgs[i].msg_len;
+                if (!ingress_filter_.IsNull() && ingress_filter_(rx_ring_->WriteSlot(i), len)) len = 0;
+                rx_ring_->SetLength(i, len);
+            }
+            rx_ring_->Publish(r);
+            // One simulator event per batch, not per frame.
+            if (!rx_drain_scheduled_.exchange(true))
+                Simulator::ScheduleWithContext(node_->GetId(), Seconds(0), &MmsgNetDevice::DrainRx, this);
+            if ((uint32_t)r < n) break;
+        }
+    }
+}
+
+void MmsgNetDevice::DrainRx() {
+    // Clear the flag first: frames published from now on schedule a new
+    // drain, frames published before are processed below.
+    rx_drain_scheduled_.store(false);
+    const uint32_t n = rx_ring_->ReadableCount();
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t len;
+        const uint8_t *frame = rx_ring_->ReadSlot(i, len);
+        if (len > 0) ForwardUp(frame, len);
+    }
+    rx_ring_->Release(n);
+}
+
+void MmsgNetDevice::ForwardUp(const uint8_t *frame, uint32_t len) {
+    Ptr<Packet> packet = Create<Packet>(frame, len);
+    EthernetHeader header(false);
+    if (packet->GetSize() < header.GetSerializedSize()) return;
+    packet->RemoveHeader(header);
+    const Mac48Address destination = header.GetDestination();
+    const uint16_t protocol = header.GetLengthType();
+
+    NetDevice::PacketType packet_type;
+    if (destination.IsBroadcast()) {
+        packet_type = NS3_PACKET_BROADCAST;
+    } else if (destination.IsGroup()) {
+        packet_type = NS3_PACKET_MULTICAST;
+    } else if (destination == address_) {
+        packet_type = NS3_PACKET_HOST;
+    } else {
+        packet_type = NS3_PACKET_OTHERHOST;
+    }
+    if (!promisc_rx_callback_.IsNull())
+        promisc_rx_callback_(this, packet, protocol, header.GetSource(), destination, packet_type);
+    if (packet_type != NS3_PACKET_OTHERHOST && !rx_callback_.IsNull())
+        rx_callback_(this, packet, protocol, header.GetSource());
+}
+
+bool MmsgNetDevice::Send(Ptr<Packet> packet, const Address &dest, uint16_t protocolNumber) {
+    return SendFrom(packet, address_, dest, protocolNumber);
+}
+
+bool MmsgNetDevice::SendFrom(Ptr<Packet> packet, const Address &source, const Address &dest,
+                             uint16_t protocolNumber) {
+    if (packet->GetSize() > mtu_ || !tx_ring_) return false;
+    EthernetHeader header(false);
+    header.SetSource(Mac48Address::ConvertFrom(source));
+    header.SetDestination(Mac48Address::ConvertFrom(dest));
+    header.SetLengthType(protocolNumber);
+    Ptr<Packet> frame = packet->Copy();
+    frame->AddHeader(header);
+
+    if (tx_ring_->WritableCount() == 0) {
+        tx_dropped_.Add();
+        tx_dropped_total_.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+    const uint32_t len = frame->CopyData(tx_ring_->WriteSlot(0), tx_ring_->GetFrameSize());
+    tx_ring_->SetLength(0, len);
+    tx_ring_->Publish(1);
+    // Pairs with the fence in WriterLoop: either the writer sees the frame,
+    // or we see that it went idle and wake it up.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (tx_idle_.load(memory_order_relaxed)) {
+        const uint64_t one = 1;
+        if (write(tx_wake_fd_, &one, sizeof(one)) < 0) {}
+    }
+    return true;
+}
+
+void MmsgNetDevice::WriterLoop() {
+    ThreadPlacement::Get().PlaceCurrentThread(ThreadPlacement::kIo, interface_ + " writer", tx_cpu_);
+    vector<mmsghdr> msgs(tx_batch_);
+    vector<iovec> iovs(tx_batch_);
+    pollfd fds[1] = {{tx_wake_fd_, POLLIN, 0}};
+
+    while (true) {
+        uint32_t n = tx_ring_->ReadableCount();
+        if (n == 0) {
+            if (stop_.load(memory_order_relaxed)) break;
+            tx_idle_.store(true, memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst);
+            if (tx_ring_->ReadableCount() == 0) {
+                if (poll(fds, 1, -1) > 0) {
+                    uint64_t v;
+                    if (read(tx_wake_fd_, &v, sizeof(v)) < 0) {}
+                }
+            }
+            tx_idle_.store(false, memory_order_relaxed);
+            continue;
+        }
+        n = min(n, tx_batch_);
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t len;
+            iovs[i].iov_base = tx_ring_->ReadSlot(i, len);
+            iovs[i].iov_len = len;
+            memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        uint32_t sent = 0;
+        while (sent < n) {
+            const int r = sendmmsg(fd_, &msgs[sent], n - sent, 0);
+            if (r > 0) {
+                sent += r;
+                continue;
+            }
+            // A frame the kernel refuses is dropped, like with write().
+            tx_dropped_.Add();
+            tx_dropped_total_.fetch_add(1, memory_order_relaxed);
+            sent++;
+        }
+        tx_ring_->Release(n);
+    }
+}
+
+void MmsgNetDevice::SetIfIndex(const uint32_t index) { ifindex_ = index; }
+
+uint32_t MmsgNetDevice::GetIfIndex(void) const { return ifindex_; }
+
+Ptr<Channel> MmsgNetDevice::GetChannel(void) const { return nullptr; }
+
+void MmsgNetDevice::SetAddress(Address address) { address_ = Mac48Address::ConvertFrom(address); }
+
+Address MmsgNetDevice::GetAddress(void) const { return address_; }
+
+bool MmsgNetDevice::SetMtu(const uint16_t mtu) {
+    // The rings are sized for the interface's MTU.
+    if (rx_ring_ && mtu > mtu_) return false;
+    mtu_ = mtu;
+    return true;
+}
+
+uint16_t MmsgNetDevice::GetMtu(void) const { return mtu_; }
+
+bool MmsgNetDevice::IsLinkUp(void) const { return link_up_; }
+
+void MmsgNetDevice::AddLinkChangeCallback(Callback<void> callback) {
+    link_change_callbacks_.ConnectWithoutContext(callback);
+}
+
+bool MmsgNetDevice::IsBroadcast(void) const { return true; }
+
+Address MmsgNetDevice::GetBroadcast(void) const { return Mac48Address::GetBroadcast(); }
+
+bool MmsgNetDevice::IsMulticast(void) const { return true; }
+
+Address MmsgNetDevice::GetMulticast(Ipv4Address multicastGroup) const {
+    return Mac48Address::GetMulticast(multicastGroup);
+}
+
+Address MmsgNetDevice::GetMulticast(Ipv6Address addr) const { return Mac48Address::GetMulticast(addr); }
+
+bool MmsgNetDevice::IsBridge(void) const { return false; }
+
+bool MmsgNetDevice::IsPointToPoint(void) const { return false; }
+
+Ptr<Node> MmsgNetDevice::GetNode(void) const { return node_; }
+
+void MmsgNetDevice::SetNode(Ptr<Node> node) { node_ = node; }
+
+bool MmsgNetDevice::NeedsArp(void) const { return true; }
+
+void MmsgNetDevice::SetReceiveCallback(NetDevice::ReceiveCallback cb) { rx_callback_ = cb; }
+
+void MmsgNetDevice::SetPromiscReceiveCallback(NetDevice::PromiscReceiveCallback cb) {
+    promisc_rx_callback_ = cb;
+}
+
+bool MmsgNetDevice::SupportsSendFrom(void) const { return true; }
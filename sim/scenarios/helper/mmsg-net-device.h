@@ -0,0 +1,120 @@
+#ifndef MMSG_NET_DEVICE_H
+#define MMSG_NET_DEVICE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "ns3/mac48-address.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "counters.h"
+#include "frame-ring.h"
+
+using namespace ns3;
+
+// MmsgNetDevice connects the simulation to a real interface, like the
+// FdNetDevice that EmuFdNetDeviceHelper creates, but moves all system calls
+// off the simulator thread and batches them:
+//  - A reader thread receives frames with recvmmsg(), up to RxBatch frames
+//    per call, directly into an RX FrameRing. The simulator is notified once
+//    per batch, and processes all frames in the ring in a single event.
+//  - The simulator thread copies frames into a TX FrameRing. A writer thread
+//    sends them with sendmmsg(), up to TxBatch frames per call.
+// Both threads are I/O threads for ThreadPlacement, and can be pinned to a
+// core of their own. An ingress filter can process (and drop) frames on the
+// reader thread, before they reach the simulator. Frames that don't fit into a full ring are dropped, and
+// counted (<interface>.rx_ring_dropped.packets and
+// <interface>.tx_ring_dropped.packets).
+class MmsgNetDevice : public NetDevice {
+public:
+    static TypeId GetTypeId(void);
+    MmsgNetDevice();
+    ~MmsgNetDevice();
+
+    // Open a packet socket on the interface. Aborts if that's not possible.
+    void Open(const std::string &interface);
+    // Pin the reader and the writer thread to a core (-1: use IoCpus).
+    void SetCpus(int rx_cpu, int tx_cpu);
+    // Run filter on every received frame, on the reader thread. The filter
+    // may modify the frame in place, and returns true to drop it. Call
+    // before the simulation starts.
+    void SetIngressFilter(Callback<bool, uint8_t *, uint32_t> filter);
+
+    // Frames dropped since Open(): by the kernel because the socket buffer
+    // was full, because the RX ring was full, and frames that couldn't be
+    // sent (TX ring full, or refused by the kernel).
+    uint64_t GetKernelDrops();
+    uint64_t GetRxRingDrops() const;
+    uint64_t GetTxDrops() const;
+
+    void SetIfIndex(const uint32_t index) override;
+    uint32_t GetIfIndex(void) const override;
+    Ptr<Channel> GetChannel(void) const override;
+    void SetAddress(Address address) override;
+    Address GetAddress(void) const override;
+    bool SetMtu(const uint16_t mtu) override;
+    uint16_t GetMtu(void) const override;
+    bool IsLinkUp(void) const override;
+    void AddLinkChangeCallback(Callback<void> callback) override;
+    bool IsBroadcast(void) const override;
+    Address GetBroadcast(void) const override;
+    bool IsMulticast(void) const override;
+    Address GetMulticast(Ipv4Address multicastGroup) const override;
+    Address GetMulticast(Ipv6Address addr) const override;
+    bool IsBridge(void) const override;
+    bool IsPointToPoint(void) const override;
+    bool Send(Ptr<Packet> packet, const Address &dest, uint16_t protocolNumber) override;
+    bool SendFrom(Ptr<Packet> packet, const Address &source, const Address &dest,
+                  uint16_t protocolNumber) override;
+    Ptr<Node> GetNode(void) const override;
+    void SetNode(Ptr<Node> node) override;
+    bool NeedsArp(void) const override;
+    void SetReceiveCallback(NetDevice::ReceiveCallback cb) override;
+    void SetPromiscReceiveCallback(NetDevice::PromiscReceiveCallback cb) override;
+    bool SupportsSendFrom(void) const override;
+
+protected:
+    void DoInitialize(void) override;
+    void DoDispose(void) override;
+
+private:
+    void ReaderLoop();
+    void WriterLoop();
+    // Runs on the simulator thread: pass all frames in the RX ring up.
+    void DrainRx();
+    void ForwardUp(const uint8_t *frame, uint32_t len);
+    void Stop();
+
+    std::string interface_;
+    Ptr<Node> node_;
+    uint32_t ifindex_;
+    Mac48Address address_;
+    uint16_t mtu_;
+    bool link_up_;
+    TracedCallback<> link_change_callbacks_;
+    NetDevice::ReceiveCallback rx_callback_;
+    NetDevice::PromiscReceiveCallback promisc_rx_callback_;
+
+    uint32_t rx_batch_, tx_batch_;
+    uint32_t rx_ring_size_, tx_ring_size_;
+    int rx_cpu_, tx_cpu_;
+    Callback<bool, uint8_t *, uint32_t> ingress_filter_;
+
+    int fd_;
+    int rx_stop_fd_;  // eventfd, wakes up the reader to stop
+    int tx_wake_fd_;  // eventfd, wakes up the idle writer
+    std::unique_ptr<FrameRing> rx_ring_, tx_ring_;
+    std::atomic<bool> rx_drain_scheduled_;
+    std::atomic<bool> tx_idle_;
+    std::atomic<bool> stop_;
+    std::thread reader_, writer_;
+
+    Counter rx_dropped_, tx_dropped_;
+    std::atomic<uint64_t> rx_dropped_total_, tx_dropped_total_;
+    uint64_t kernel_dropped_;
+};
+
+#endif /* MMSG_NET_DEVICE_H */
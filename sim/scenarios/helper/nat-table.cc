@@ -0,0 +1,432 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "nat-table.h"
+#include "event-log.h"
+
+#include "ns3/abort.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
+#include "ns3/simulator.h"
+
+using namespace ns3;
+using namespace std;
+
+const uint32_t NatTable::kNone;
+
+static const uint8_t kNet6[6] = {0xfd, 0x00, 0xca, 0xfe, 0xca, 0xfe};
+
+enum Side { kClientSide, kServerSide, kOtherSide };
+
+// Clients are on subnet n < 100, servers on subnet n + 100, see
+// findInterfaces(). The link is subnet 50.
+static Side GetSide(const uint8_t *addr, bool ipv6) {
+    uint32_t subnet, server_start, link;
+    if (ipv6) {
+        if (memcmp(addr, kNet6, 6) != 0) return kOtherSide;
+        subnet = addr[6] << 8 | addr[7];
+        server_start = 0x100;
+        link = 0x50;
+    } else {
+        if (addr[0] != 193 || addr[1] != 167) return kOtherSide;
+        subnet = addr[2];
+        server_start = 100;
+        link = 50;
+    }
+    if (subnet == link || subnet >= 2 * server_start) return kOtherSide;
+    return subnet >= server_start ? kServerSide : kClientSide;
+}
+
+static void LogPacket(const QuicPacket &qp, EventType type) {
+    EventRecord r = EventLog::PacketRecord(type, qp);
+    EventLog::Get().Log(r);
+}
+
+static void LogDrop(const QuicPacket &qp, NatDropReason reason) {
+    EventLog &log = EventLog::Get();
+    if (!log.IsEnabled(EventLog::kPackets)) return;
+    EventRecord r = EventLog::PacketRecord(kEventUnknownBinding, qp);
+    r.arg16 = reason;
+    log.Log(r);
+}
+
+// All NAT tables, for ReportAll().
+static vector<NatTable *> &Tables() {
+    static vector<NatTable *> tables;
+    return tables;
+}
+
+static const char *const kModeNames[] = {"full-cone", "address-restricted", "port-restricted", "symmetric"};
+
+NatTable::Mode NatTable::ParseMode(const string &name) {
+    for (int i = 0; i <= kSymmetric; i++) {
+        if (name == kModeNames[i]) return Mode(i);
+    }
+    NS_ABORT_MSG("Invalid NAT mode: " << name
+                                      << " (expected full-cone, address-restricted, port-restricted or symmetric)");
+}
+
+const char *NatTable::GetModeName(Mode mode) { return kModeNames[mode]; }
+
+static void LogRebound(const QuicPacket &qp, ReboundField field) {
+    EventLog &log = EventLog::Get();
+    if (!log.IsEnabled(EventLog::kPackets)) return;
+    EventRecord r = EventLog::PacketRecord(kEventRebound, qp);
+    r.arg16 = field;
+    log.Log(r);
+}
+
+NatTable::NatTable(const string &stream)
+    : mode_(kSymmetric), preserve_ports_(true), rng_(stream), index_(16, kNone), index_mask_(15), size_(0),
+      by_port_(65536, kNone), now_(0), expired_lifetime_(0) {
+    CounterRegistry &registry = CounterRegistry::Get();
+    created_ = registry.RegisterCounter("nat.created.bindings");
+    expired_ = registry.RegisterCounter("nat.expired.bindings");
+    recreated_ = registry.RegisterCounter("nat.recreated.bindings");
+    rebound_ = registry.RegisterCounter("nat.rebound.bindings");
+    active_ = registry.RegisterGauge("nat.active.bindings");
+    no_binding_ = registry.RegisterCounter("nat.no_binding.packets");
+    filtered_ = registry.RegisterCounter("nat.filtered.packets");
+    Tables().push_back(this);
+}
+
+NatTable::~NatTable() {
+    vector<NatTable *> &tables = Tables();
+    tables.erase(remove(tables.begin(), tables.end(), this), tables.end());
+}
+
+void NatTable::SetMode(Mode mode) { mode_ = mode; }
+
+void NatTable::SetPortPreservation(bool preserve) { preserve_ports_ = preserve; }
+
+void NatTable::Serialize(const Address &addr, bool ipv6, uint8_t *dst) {
+    memset(dst, 0, 16);
+    if (ipv6)
+        Ipv6Address::ConvertFrom(addr).Serialize(dst);
+    else
+        Ipv4Address::ConvertFrom(addr).Serialize(dst);
+}
+
+uint32_t NatTable::Hash(const FlowKey &key) {
+    uint64_t h = key.family;
+    for (int i = 0; i < 16; i += 8) {
+        uint64_t c, s;
+        memcpy(&c, key.client + i, 8);
+        memcpy(&s, key.server + i, 8);
+        h = RandomSource::Mix(h ^ c) ^ s;
+    }
+    return RandomSource::Mix(h ^ (uint64_t(key.client_port) << 16 | key.server_port)) >> 32;
+}
+
+uint32_t NatTable::EndpointHash(const FlowKey &key) {
+    FlowKey endpoint = key;
+    memset(endpoint.server, 0, 16);
+    endpoint.server_port = 0;
+    return Hash(endpoint);
+}
+
+bool NatTable::Equal(const FlowKey &a, const FlowKey &b) {
+    return a.family == b.family && a.client_port == b.client_port && a.server_port == b.server_port &&
+           memcmp(a.client, b.client, 16) == 0 && memcmp(a.server, b.server, 16) == 0;
+}
+
+uint32_t NatTable::Find(const FlowKey &key, uint32_t hash) const {
+    for (uint32_t i = hash & index_mask_;; i = (i + 1) & index_mask_) {
+        const uint32_t id = index_[i];
+        if (id == kNone) return kNone;
+        if (bindings_[id].hash == hash && Equal(bindings_[id].key, key)) return id;
+    }
+}
+
+void NatTable::Grow() {
+    vector<uint32_t> index(index_.size() * 2, kNone);
+    const uint32_t mask = index.size() - 1;
+    for (uint32_t id = 0; id < bindings_.size(); id++) {
+        if (!bindings_[id].used) continue;
+        uint32_t i = bindings_[id].hash & mask;
+        while (index[i] != kNone) i = (i + 1) & mask;
+        index[i] = id;
+    }
+    index_.swap(index);
+    index_mask_ = mask;
+}
+
+uint16_t NatTable::AllocatePort(uint16_t preferred, uint16_t avoid) {
+    if (preferred != 0 && by_port_[preferred] == kNone) return preferred;
+    // Random ports are free most of the time, unless the table is nearly full.
+    for (int i = 0; i < 16; i++) {
+        const uint16_t port = rng_.Between(1, UINT16_MAX);
+        if (by_port_[port] == kNone && port != avoid) return port;
+    }
+    const uint32_t start = rng_.Between(1, UINT16_MAX);
+    for (uint32_t i = 0; i < UINT16_MAX; i++) {
+        const uint16_t port = (start - 1 + i) % UINT16_MAX + 1;
+        if (by_port_[port] == kNone && port != avoid) return port;
+    }
+    return 0;
+}
+
+bool NatTable::IsAllowed(const Binding &b, const uint8_t *server, uint16_t port) const {
+    switch (mode_) {
+        case kFullCone:
+            return true;
+        case kSymmetric:
+            return b.key.server_port == port && memcmp(b.key.server, server, 16) == 0;
+        default:
+            for (const Remote &r : b.remotes) {
+                if (memcmp(r.addr, server, 16) == 0 && (mode_ == kAddressRestricted || r.port == port)) return true;
+            }
+            return false;
+    }
+}
+
+void NatTable::Allow(Binding &b, const uint8_t *server, uint16_t port) {
+    if (IsAllowed(b, server, port)) return;
+    Remote r;
+    memcpy(r.addr, server, 16);
+    r.port = port;
+    b.remotes.push_back(r);
+}
+
+uint32_t NatTable::Add(const FlowKey &key, uint32_t hash, const Address &addr) {
+    // A client whose binding expired gets a different port, even with port
+    // preservation, like on many carrier-grade NATs: the servers see a
+    // rebinding after an idle period.
+    const auto expired = expired_endpoints_.empty() ? expired_endpoints_.end()
+                                                    : expired_endpoints_.find(EndpointHash(key));
+    const bool recreated = expired != expired_endpoints_.end();
+    const uint16_t port = recreated ? AllocatePort(0, expired->second)
+                                    : AllocatePort(preserve_ports_ ? key.client_port : 0, 0);
+    if (port == 0) return kNone;
+    if (recreated) {
+        expired_endpoints_.erase(expired);
+        recreated_.Add();
+    }
+
+    uint32_t client = 0;
+    while (client < clients_.size() && !(clients_[client].internal == addr)) client++;
+    if (client == clients_.size()) clients_.push_back({addr, addr});
+
+    if (2 * (size_ + 1) > index_.size()) Grow();
+    uint32_t id;
+    if (free_.empty()) {
+        id = bindings_.size();
+        bindings_.push_back(Binding());
+    } else {
+        id = free_.back();
+        free_.pop_back();
+    }
+    bindings_[id] = {key, hash, client, port, now_, now_, true, {}};
+    by_port_[port] = id;
+    size_++;
+    created_.Add();
+    active_.Set(size_);
+
+    uint32_t i = hash & index_mask_;
+    while (index_[i] != kNone) i = (i + 1) & index_mask_;
+    index_[i] = id;
+
+    if (!tick_.IsZero()) wheel_[(now_ + kTicksPerTimeout) % kWheelSlots].push_back(id);
+    return id;
+}
+
+void NatTable::Expire(uint32_t id) {
+    Binding &b = bindings_[id];
+    const Client &client = clients_[b.client];
+    EventRecord r = EventLog::Record(kEventBindingExpired);
+    EventLog::SetAddress(r.src, r.family, client.internal);
+    EventLog::SetAddress(r.dst, r.family, client.external);
+    r.src_port = b.key.client_port;
+    r.dst_port = b.port;
+    EventLog::Get().Log(r);
+
+    by_port_[b.port] = kNone;
+    // Remove the binding from the index, and move the entries after it back,
+    // so that lookups don't need tombstones.
+    uint32_t i = b.hash & index_mask_;
+    while (index_[i] != id) i = (i + 1) & index_mask_;
+    for (uint32_t j = (i + 1) & index_mask_; index_[j] != kNone; j = (j + 1) & index_mask_) {
+        // The entry at j can move to i unless its home slot is cyclically in
+        // (i, j].
+        const uint32_t home = bindings_[index_[j]].hash & index_mask_;
+        if (((j - home) & index_mask_) >= ((j - i) & index_mask_)) {
+            index_[i] = index_[j];
+            i = j;
+        }
+    }
+    index_[i] = kNone;
+
+    b.used = false;
+    b.remotes.clear();
+    free_.push_back(id);
+    size_--;
+    expired_.Add();
+    active_.Set(size_);
+    expired_lifetime_ += now_ - b.created;
+    expired_endpoints_[EndpointHash(b.key)] = b.port;
+}
+
+void NatTable::SetIdleTimeout(Time timeout) {
+    if (timeout.IsZero()) return;
+    idle_ = timeout;
+    tick_ = NanoSeconds(timeout.GetNanoSeconds() / kTicksPerTimeout);
+    Simulator::Schedule(tick_, &NatTable::Tick, this);
+}
+
+void NatTable::Tick() {
+    lock_guard<mutex> lock(mutex_);
+    now_++;
+    expiring_.swap(wheel_[now_ % kWheelSlots]);
+    for (uint32_t id : expiring_) {
+        const Binding &b = bindings_[id];
+        if (now_ - b.last_used >= kTicksPerTimeout)
+            Expire(id);
+        else
+            wheel_[(b.last_used + kTicksPerTimeout) % kWheelSlots].push_back(id);
+    }
+    expiring_.clear();
+    Simulator::Schedule(tick_, &NatTable::Tick, this);
+}
+
+Address NatTable::NewExternalAddress(const Client &client) {
+    const bool ipv6 = Ipv6Address::IsMatchingType(client.internal);
+    uint8_t buf[16];
+    Serialize(client.external, ipv6, buf);
+    // Replace the last byte of the address.
+    const int last = ipv6 ? 15 : 3;
+    const uint8_t old_last = buf[last];
+    while (true) {
+        buf[last] = rng_.Between(1, 0xfe);
+        if (buf[last] == old_last) continue;
+        const Address addr = ipv6 ? Address(Ipv6Address(buf)) : Address(Ipv4Address::Deserialize(buf));
+        bool taken = false;
+        for (const Client &c : clients_) taken |= c.internal == addr || c.external == addr;
+        if (!taken) return addr;
+    }
+}
+
+void NatTable::Rebind(bool rebind_addr) {
+    lock_guard<mutex> lock(mutex_);
+    EventLog &log = EventLog::Get();
+    vector<Address> old_external;
+    for (Client &client : clients_) {
+        old_external.push_back(client.external);
+        if (!rebind_addr) continue;
+        client.external = NewExternalAddress(client);
+        EventRecord r = EventLog::Record(kEventRebindAddress);
+        EventLog::SetAddress(r.src, r.family, old_external.back());
+        EventLog::SetAddress(r.dst, r.family, client.external);
+        log.Log(r);
+    }
+
+    for (uint32_t id = 0; id < bindings_.size(); id++) {
+        Binding &b = bindings_[id];
+        if (!b.used) continue;
+        const uint16_t old_port = b.port;
+        // The old port is still taken, so the new one differs. If all other
+        // ports are taken, the binding keeps its port.
+        const uint16_t port = AllocatePort(0, 0);
+        if (port != 0) {
+            by_port_[old_port] = kNone;
+            by_port_[port] = id;
+            b.port = port;
+            rebound_.Add();
+        }
+        EventRecord r = EventLog::Record(kEventRebind);
+        EventLog::SetAddress(r.src, r.family, old_external[b.client]);
+        EventLog::SetAddress(r.dst, r.family, clients_[b.client].external);
+        r.src_port = old_port;
+        r.dst_port = b.port;
+        log.Log(r);
+    }
+}
+
+NatTable::Verdict NatTable::Translate(QuicPacket &qp) {
+    const bool ipv6 = qp.IsIpv6();
+    const Address src = qp.GetSource();
+    FlowKey key;
+    key.family = ipv6 ? 6 : 4;
+    Serialize(src, ipv6, key.client);
+
+    const Side side = GetSide(key.client, ipv6);
+    lock_guard<mutex> lock(mutex_);
+    if (side == kClientSide) {
+        uint8_t server[16];
+        Serialize(qp.GetDestination(), ipv6, server);
+        key.client_port = qp.GetSourcePort();
+        // Cone NATs map all flows of a client address and port to one
+        // binding.
+        if (mode_ == kSymmetric) {
+            memcpy(key.server, server, 16);
+            key.server_port = qp.GetDestinationPort();
+        } else {
+            memset(key.server, 0, 16);
+            key.server_port = 0;
+        }
+        const uint32_t hash = Hash(key);
+        uint32_t id = Find(key, hash);
+        if (id == kNone) id = Add(key, hash, src);
+        if (id == kNone) {
+            LogDrop(qp, kNatPortsExhausted);
+            return kDrop;
+        }
+        Binding &b = bindings_[id];
+        b.last_used = now_;
+        if (mode_ == kAddressRestricted || mode_ == kPortRestricted) Allow(b, server, qp.GetDestinationPort());
+        const Address &external = clients_[b.client].external;
+        if (b.port == key.client_port && external == src) return kUnchanged;
+        qp.SetSourcePort(b.port);
+        qp.SetSource(external);
+        LogRebound(qp, kReboundSource);
+        return kTranslatedSource;
+    }
+
+    if (side == kServerSide) {
+        // The packet comes from a server: key.client holds its address.
+        const uint32_t id = by_port_[qp.GetDestinationPort()];
+        if (id == kNone || bindings_[id].key.family != key.family ||
+            !(clients_[bindings_[id].client].external == qp.GetDestination())) {
+            no_binding_.Add();
+            LogDrop(qp, kNatNoBinding);
+            return kDrop;
+        }
+        Binding &b = bindings_[id];
+        if (!IsAllowed(b, key.client, qp.GetSourcePort())) {
+            filtered_.Add();
+            LogDrop(qp, kNatFiltered);
+            return kDrop;
+        }
+        // Packets from the servers keep the binding alive, like on most NATs.
+        b.last_used = now_;
+        const Client &client = clients_[b.client];
+        if (b.port == b.key.client_port && client.external == client.internal) return kUnchanged;
+        qp.SetDestination(client.internal);
+        qp.SetDestinationPort(b.key.client_port);
+        LogRebound(qp, kReboundDestination);
+        return kTranslatedDestination;
+    }
+
+    LogPacket(qp, kEventUnknownSource);
+    return kDrop;
+}
+
+void NatTable::Report() {
+    lock_guard<mutex> lock(mutex_);
+    cout << "NAT (" << GetModeName(mode_) << ", ";
+    if (tick_.IsZero())
+        cout << "no idle timeout";
+    else
+        cout << "idle timeout " << idle_.GetSeconds() << "s";
+    cout << "): " << created_.Get() << " bindings created, " << expired_.Get() << " expired";
+    if (expired_.Get() > 0)
+        cout << " after " << expired_lifetime_ * tick_.GetSeconds() / expired_.Get() << "s on average";
+    cout << ", " << recreated_.Get() << " re-created after expiring, " << rebound_.Get() << " rebound, " << size_
+         << " active" << endl;
+    cout << "NAT: dropped " << no_binding_.Get() << " packets towards the clients without a binding, "
+         << filtered_.Get() << " filtered" << endl;
+}
+
+void NatTable::ReportAll() {
+    for (NatTable *table : Tables()) table->Report();
+}
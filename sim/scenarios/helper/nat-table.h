@@ -0,0 +1,171 @@
+#ifndef NAT_TABLE_H
+#define NAT_TABLE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ns3/address.h"
+#include "ns3/nstime.h"
+#include "counters.h"
+#include "quic-packet.h"
+#include "random-source.h"
+
+using namespace ns3;
+
+// NatTable is the NAT of the rebind error model and stage. It sits in front
+// of the clients (193.167.<n>.0/24 and fd00:cafe:cafe:<n>::/64, n < 100),
+// and translates their flows to the servers (subnets n + 100).
+//
+// A binding maps a flow (the 5-tuple, all flows are UDP), or all flows from
+// a client's address and port, depending on the Mode, to an external port,
+// on the external address of its client. Initially, the external address is
+// the client's own address. With port preservation, the external port is the
+// client's port if it is free, so packets are only rewritten after the first
+// Rebind().
+//
+// External ports are unique across all bindings: packets towards the clients
+// are looked up in an array indexed by port, and then checked against the
+// binding's 5-tuple. Packets from the clients are looked up in a flat,
+// open-addressing hash table. Bindings that carried no packets for the idle
+// timeout expire, and their ports are reused. Expiry is driven by a timer
+// wheel: packets only record the current tick in their binding, and a
+// binding is checked when its slot comes up, and moved to a later slot if it
+// was used since. A client that sends again after its binding expired gets
+// a new binding, on a new port even if ports are preserved.
+//
+// The binding churn is exported as nat.* counters, and printed at the end of
+// the run, see ReportAll().
+//
+// Translate() can be called from any thread.
+class NatTable {
+public:
+    // How flows are mapped to bindings, and which packets from the servers
+    // a binding lets through (see RFC 4787):
+    enum Mode {
+        kFullCone,          // a binding per client address and port, open to all servers
+        kAddressRestricted, // a binding per client address and port, open to
+                            // the server addresses the client sent to
+        kPortRestricted,    // a binding per client address and port, open to
+                            // the server addresses and ports the client sent to
+        kSymmetric,         // a binding per flow, open to the flow's server
+    };
+    // Parses full-cone, address-restricted, port-restricted or symmetric.
+    // Aborts on errors.
+    static Mode ParseMode(const std::string &name);
+    static const char *GetModeName(Mode mode);
+
+    // What Translate() did to a packet.
+    enum Verdict {
+        kUnchanged,             // nothing, forward the packet
+        kTranslatedSource,      // translated a packet towards a server
+        kTranslatedDestination, // translated a packet towards a client
+        kDrop,                  // drop the packet: unknown source or binding
+    };
+
+    // stream names the RandomStream of the new ports and addresses.
+    explicit NatTable(const std::string &stream);
+    ~NatTable();
+
+    // kSymmetric by default. Call before the first packet.
+    void SetMode(Mode mode);
+    // Whether new bindings keep the client's port if it is free (the
+    // default). Bindings that replace an expired one never do.
+    void SetPortPreservation(bool preserve);
+
+    // Expire bindings that carried no packets for timeout. Zero (the default)
+    // keeps bindings forever. Call once, before the simulation starts.
+    void SetIdleTimeout(Time timeout);
+    // Translate qp. Logs rebound and dropped packets.
+    Verdict Translate(QuicPacket &qp);
+    // Assign new external ports to all bindings, and, if rebind_addr, new
+    // external addresses to all clients, in the client's own /24 or /64.
+    void Rebind(bool rebind_addr);
+
+    // Print the binding churn of all NAT tables.
+    static void ReportAll();
+
+private:
+    static const uint32_t kNone = UINT32_MAX;
+    // Bindings expire between kTicksPerTimeout and kTicksPerTimeout + 1
+    // ticks after their last packet.
+    static const uint32_t kTicksPerTimeout = 8;
+    static const uint32_t kWheelSlots = 16;
+
+    struct FlowKey {
+        uint8_t family; // 4 or 6
+        uint8_t client[16], server[16];
+        uint16_t client_port, server_port;
+    };
+    struct Client {
+        Address internal, external;
+    };
+    // A server that a restricted binding lets through.
+    struct Remote {
+        uint8_t addr[16];
+        uint16_t port;
+    };
+    struct Binding {
+        FlowKey key;        // the server is zero, unless kSymmetric
+        uint32_t hash;
+        uint32_t client;    // in clients_
+        uint16_t port;      // external port
+        uint32_t created;   // tick
+        uint32_t last_used; // tick
+        bool used;
+        std::vector<Remote> remotes; // kAddressRestricted, kPortRestricted
+    };
+
+    static void Serialize(const Address &addr, bool ipv6, uint8_t *dst);
+    static uint32_t Hash(const FlowKey &key);
+    // The hash of the client address and port of key.
+    static uint32_t EndpointHash(const FlowKey &key);
+    static bool Equal(const FlowKey &a, const FlowKey &b);
+
+    // Returns true if the binding lets a packet from server:port through.
+    bool IsAllowed(const Binding &b, const uint8_t *server, uint16_t port) const;
+    // Let packets from server:port through b.
+    void Allow(Binding &b, const uint8_t *server, uint16_t port);
+    void Report();
+
+    uint32_t Find(const FlowKey &key, uint32_t hash) const;
+    // Create a binding for key, from client address addr. Returns kNone if
+    // all ports are in use.
+    uint32_t Add(const FlowKey &key, uint32_t hash, const Address &addr);
+    void Expire(uint32_t id);
+    void Grow();
+    // A free port other than avoid, preferably preferred. Returns 0 if all
+    // ports are in use.
+    uint16_t AllocatePort(uint16_t preferred, uint16_t avoid);
+    Address NewExternalAddress(const Client &client);
+    void Tick();
+
+    std::mutex mutex_;
+    Mode mode_;
+    bool preserve_ports_;
+    RandomStream rng_;
+    std::vector<Client> clients_;
+    std::vector<Binding> bindings_;
+    std::vector<uint32_t> free_;     // unused entries of bindings_
+    std::vector<uint32_t> index_;    // bindings_ by hash of the 5-tuple
+    uint32_t index_mask_;
+    uint32_t size_;                  // bindings in use
+    std::vector<uint32_t> by_port_;  // bindings_ by external port
+
+    Time idle_;
+    Time tick_;                      // zero: bindings don't expire
+    uint32_t now_;                   // in ticks
+    std::vector<uint32_t> wheel_[kWheelSlots];
+    std::vector<uint32_t> expiring_;
+    // The external ports of expired bindings, by hash of their client
+    // address and port.
+    std::unordered_map<uint32_t, uint16_t> expired_endpoints_;
+
+    Counter created_, expired_, recreated_, rebound_, active_;
+    Counter no_binding_, filtered_;
+    uint64_t expired_lifetime_; // in ticks
+};
+
+#endif /* NAT_TABLE_H */
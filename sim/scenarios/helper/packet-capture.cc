@@ -0,0 +1,346 @@
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "packet-capture.h"
+#include "thread-placement.h"
+
+#include "ns3/double.h"
+#include "ns3/global-value.h"
+#include "ns3/ipv4-queue-disc-item.h"
+#include "ns3/ipv6-queue-disc-item.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+using namespace ns3;
+using namespace std;
+
+static GlobalValue g_captureFile = GlobalValue("CaptureFile",
+    "pcapng file that the packets on the simulated link are written to, annotated with what "
+    "happened to them (empty: don't capture)",
+    StringValue(""), MakeStringChecker());
+
+static GlobalValue g_captureSnapLen = GlobalValue("CaptureSnapLen",
+    "Maximum number of bytes captured per packet",
+    UintegerValue(128), MakeUintegerChecker<uint32_t>(64, 2048));
+
+static GlobalValue g_captureSampling = GlobalValue("CaptureSampling",
+    "Fraction of the packets to capture",
+    DoubleValue(1.0), MakeDoubleChecker<double>(0, 1));
+
+// pcapng block types and options.
+static const uint32_t kSectionHeaderBlock = 0x0a0d0d0a;
+static const uint32_t kInterfaceDescriptionBlock = 1;
+static const uint32_t kEnhancedPacketBlock = 6;
+static const uint16_t kOptEndOfOpt = 0;
+static const uint16_t kOptComment = 1;
+static const uint16_t kOptShbUserAppl = 4;
+static const uint16_t kOptIfName = 2;
+static const uint16_t kOptIfTsresol = 9;
+
+// The notes for the packet that is being processed on this thread.
+struct PendingNotes {
+    uint32_t count;
+    EventRecord note[4];
+};
+static thread_local PendingNotes t_notes;
+
+// Frames have no packet UID to sample by.
+static thread_local uint64_t t_frame_key;
+
+void PacketCapture::StartClock() {
+    const int64_t now = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    epoch_ns_.store(now - Simulator::Now().GetNanoSeconds(), memory_order_relaxed);
+}
+
+void PacketCapture::SetEpoch(Time origin) { epoch_ns_.store(origin.GetNanoSeconds(), memory_order_relaxed); }
+
+PacketCapture &PacketCapture::Get() {
+    static PacketCapture capture;
+    return capture;
+}
+
+PacketCapture::PacketCapture()
+    : enabled_(false), file_(nullptr), snap_len_(0), sample_threshold_(0), interfaces_(0), epoch_ns_(0),
+      ring_(nullptr), enqueue_pos_(0), dequeue_pos_(0), written_(0), dropped_(0), stop_(false) {
+    StringValue filename;
+    g_captureFile.GetValue(filename);
+    if (filename.Get().empty()) return;
+    UintegerValue snap_len;
+    g_captureSnapLen.GetValue(snap_len);
+    DoubleValue sampling;
+    g_captureSampling.GetValue(sampling);
+
+    file_ = fopen(filename.Get().c_str(), "wb");
+    if (!file_) {
+        cout << "Can't open capture " << filename.Get() << ": " << strerror(errno)
+             << ", disabling capture" << endl;
+        return;
+    }
+    snap_len_ = snap_len.Get();
+    sample_threshold_ = sampling.Get() >= 1 ? UINT64_MAX : (uint64_t)(sampling.Get() * 18446744073709551616.0);
+
+    vector<uint8_t> shb;
+    const uint32_t bom = 0x1a2b3c4d;
+    const uint16_t version[2] = {1, 0};
+    const int64_t section_length = -1;
+    shb.insert(shb.end(), (const uint8_t *)&bom, (const uint8_t *)&bom + 4);
+    shb.insert(shb.end(), (const uint8_t *)version, (const uint8_t *)version + 4);
+    shb.insert(shb.end(), (const uint8_t *)&section_length, (const uint8_t *)&section_length + 8);
+    AppendOption(shb, kOptShbUserAppl, "quic-network-simulator");
+    AppendOption(shb, kOptEndOfOpt, "");
+    WriteBlock(kSectionHeaderBlock, shb);
+
+    ring_ = new Slot[kRingSize];
+    for (uint32_t i = 0; i < kRingSize; i++) ring_[i].seq.store(i, memory_order_relaxed);
+    data_.resize((size_t)kRingSize * snap_len_);
+    enabled_.store(true);
+    writer_ = thread(&PacketCapture::WriterLoop, this);
+}
+
+PacketCapture::~PacketCapture() {
+    Stop();
+    delete[] ring_;
+}
+
+void PacketCapture::AppendOption(vector<uint8_t> &body, uint16_t code, const string &value) {
+    const uint16_t len = value.size();
+    body.insert(body.end(), (const uint8_t *)&code, (const uint8_t *)&code + 2);
+    body.insert(body.end(), (const uint8_t *)&len, (const uint8_t *)&len + 2);
+    body.insert(body.end(), value.begin(), value.end());
+    body.resize((body.size() + 3) & ~3u, 0);
+}
+
+void PacketCapture::WriteBlock(uint32_t type, const vector<uint8_t> &body) {
+    const uint32_t len = 12 + body.size();
+    fwrite(&type, 4, 1, file_);
+    fwrite(&len, 4, 1, file_);
+    fwrite(body.data(), 1, body.size(), file_);
+    fwrite(&len, 4, 1, file_);
+}
+
+uint32_t PacketCapture::AddInterface(const string &name, uint16_t link_type) {
+    if (!file_) return 0;
+    vector<uint8_t> idb;
+    const uint16_t reserved = 0;
+    idb.insert(idb.end(), (const uint8_t *)&link_type, (const uint8_t *)&link_type + 2);
+    idb.insert(idb.end(), (const uint8_t *)&reserved, (const uint8_t *)&reserved + 2);
+    idb.insert(idb.end(), (const uint8_t *)&snap_len_, (const uint8_t *)&snap_len_ + 4);
+    AppendOption(idb, kOptIfName, name);
+    AppendOption(idb, kOptIfTsresol, string(1, 9)); // timestamps in ns
+    AppendOption(idb, kOptEndOfOpt, "");
+    lock_guard<mutex> lock(file_mutex_);
+    WriteBlock(kInterfaceDescriptionBlock, idb);
+    return interfaces_++;
+}
+
+void PacketCapture::Note(const EventRecord &r) {
+    switch (r.type) {
+        // Only what changed the packet or its fate. Other per-packet records
+        // (e.g. channel delays) are not created while the packet is received.
+        case kEventDropRateDrop:
+        case kEventCorrupt:
+        case kEventDroplistDrop:
+        case kEventUnknownBinding:
+        case kEventUnknownSource:
+        case kEventComplexDrop:
+        case kEventRebound:
+        case kEventLossModelDrop:
+            break;
+        default:
+            return;
+    }
+    if (t_notes.count < kMaxNotes) t_notes.note[t_notes.count++] = r;
+}
+
+bool PacketCapture::Sample(uint64_t key) const {
+    if (sample_threshold_ == UINT64_MAX) return true;
+    // Fibonacci hashing spreads consecutive keys evenly.
+    return key * 0x9e3779b97f4a7c15ull < sample_threshold_;
+}
+
+PacketCapture::Slot *PacketCapture::Reserve(uint32_t interface, uint32_t orig_len, Verdict verdict,
+                                            uint64_t &pos) {
+    // Bounded multi-producer queue, see EventLog::Log().
+    pos = enqueue_pos_.load(memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+        slot = &ring_[pos & (kRingSize - 1)];
+        const uint64_t seq = slot->seq.load(memory_order_acquire);
+        const int64_t diff = (int64_t)seq - (int64_t)pos;
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            // The writer thread fell behind. Never block the simulation.
+            dropped_.fetch_add(1, memory_order_relaxed);
+            return nullptr;
+        } else {
+            pos = enqueue_pos_.load(memory_order_relaxed);
+        }
+    }
+    slot->time = epoch_ns_.load(memory_order_relaxed) + Simulator::Now().GetNanoSeconds();
+    slot->interface = interface;
+    slot->orig_len = orig_len;
+    slot->cap_len = min(orig_len, snap_len_);
+    slot->verdict = verdict;
+    slot->notes = t_notes.count;
+    memcpy(slot->note, t_notes.note, t_notes.count * sizeof(EventRecord));
+    return slot;
+}
+
+uint8_t *PacketCapture::GetData(const Slot *slot) {
+    return &data_[(size_t)(slot - ring_) * snap_len_];
+}
+
+void PacketCapture::Commit(Slot *slot, uint64_t pos) {
+    slot->seq.store(pos + 1, memory_order_release);
+}
+
+void PacketCapture::Capture(uint32_t interface, Ptr<const Packet> packet, Verdict verdict) {
+    if (IsEnabled() && Sample(packet->GetUid())) {
+        uint64_t pos;
+        Slot *slot = Reserve(interface, packet->GetSize(), verdict, pos);
+        if (slot) {
+            packet->CopyData(GetData(slot), slot->cap_len);
+            Commit(slot, pos);
+        }
+    }
+    t_notes.count = 0;
+}
+
+void PacketCapture::CaptureDropped(uint32_t interface, Ptr<const QueueDiscItem> item) {
+    if (!IsEnabled() || !Sample(item->GetPacket()->GetUid())) return;
+    // Queue disc items hold the IP header separately, and the PPP header is
+    // only added when the packet is sent.
+    Ptr<Packet> packet = item->GetPacket()->Copy();
+    uint16_t protocol;
+    if (Ptr<const Ipv4QueueDiscItem> ipv4 = DynamicCast<const Ipv4QueueDiscItem>(item)) {
+        packet->AddHeader(ipv4->GetHeader());
+        protocol = 0x21;
+    } else if (Ptr<const Ipv6QueueDiscItem> ipv6 = DynamicCast<const Ipv6QueueDiscItem>(item)) {
+        packet->AddHeader(ipv6->GetHeader());
+        protocol = 0x57;
+    } else {
+        return;
+    }
+    uint64_t pos;
+    Slot *slot = Reserve(interface, packet->GetSize() + 2, kDroppedByQueue, pos);
+    if (!slot) return;
+    uint8_t *data = GetData(slot);
+    data[0] = protocol >> 8;
+    data[1] = protocol & 0xff;
+    packet->CopyData(data + 2, slot->cap_len - 2);
+    // Notes belong to packets that arrived, not to this one.
+    slot->notes = 0;
+    Commit(slot, pos);
+}
+
+void PacketCapture::CaptureFrame(uint32_t interface, const uint8_t *frame, uint32_t len, Verdict verdict) {
+    if (IsEnabled() && (verdict != kForwarded || t_notes.count > 0) && Sample(++t_frame_key)) {
+        uint64_t pos;
+        Slot *slot = Reserve(interface, len, verdict, pos);
+        if (slot) {
+            memcpy(GetData(slot), frame, slot->cap_len);
+            Commit(slot, pos);
+        }
+    }
+    t_notes.count = 0;
+}
+
+static string FormatAddress(uint8_t family, const uint8_t *addr) {
+    char buf[INET6_ADDRSTRLEN];
+    if (family == 6) {
+        inet_ntop(AF_INET6, addr, buf, sizeof(buf));
+        return "[" + string(buf) + "]";
+    }
+    inet_ntop(AF_INET, addr, buf, sizeof(buf));
+    return buf;
+}
+
+static string FormatNote(const EventRecord &r) {
+    char buf[128];
+    switch (r.type) {
+        case kEventDropRateDrop:
+            return "model: drop-rate";
+        case kEventCorrupt:
+            snprintf(buf, sizeof(buf), "corrupted-at-offset=%u (0x%02x -> 0x%02x)", r.arg[2], r.arg16 >> 8,
+                     r.arg16 & 0xff);
+            return buf;
+        case kEventDroplistDrop:
+            return "model: droplist, packet " + to_string(r.arg[0]);
+        case kEventUnknownBinding:
+            if (r.arg16 == kNatFiltered)
+                return "model: rebind, filtered by " + FormatAddress(r.family, r.dst) + ":" + to_string(r.dst_port);
+            if (r.arg16 == kNatPortsExhausted) return "model: rebind, no free port";
+            return "model: rebind, no binding for " + FormatAddress(r.family, r.dst) + ":" + to_string(r.dst_port);
+        case kEventUnknownSource:
+            return "model: rebind, unknown source " + FormatAddress(r.family, r.src);
+        case kEventComplexDrop:
+            return string("model: complex, ") +
+                   (r.arg16 == kComplexDropCyclic ? "cyclic" : r.arg16 == kComplexDropBurst ? "burst" : "random");
+        case kEventLossModelDrop:
+            return string("model: ") + kLossModelNames[r.arg16 < 4 ? r.arg16 : 0] + ", state " + to_string(r.arg[2]);
+        case kEventRebound:
+            // The record holds the translated flow.
+            if (r.arg16 == kReboundSource)
+                return "rebound-to=" + FormatAddress(r.family, r.src) + ":" + to_string(r.src_port);
+            return "rebound-to=" + FormatAddress(r.family, r.dst) + ":" + to_string(r.dst_port);
+    }
+    return "";
+}
+
+void PacketCapture::WritePacket(const Slot &slot) {
+    static const char *verdicts[] = {"forwarded", "dropped-by-queue", "dropped-by-model"};
+    vector<uint8_t> epb;
+    const uint32_t ts_high = (uint64_t)slot.time >> 32, ts_low = slot.time & 0xffffffff;
+    const uint32_t fields[] = {slot.interface, ts_high, ts_low, slot.cap_len, slot.orig_len};
+    epb.insert(epb.end(), (const uint8_t *)fields, (const uint8_t *)fields + sizeof(fields));
+    const uint8_t *data = GetData(&slot);
+    epb.insert(epb.end(), data, data + slot.cap_len);
+    epb.resize((epb.size() + 3) & ~3u, 0);
+    AppendOption(epb, kOptComment, verdicts[slot.verdict]);
+    for (uint32_t i = 0; i < slot.notes; i++) AppendOption(epb, kOptComment, FormatNote(slot.note[i]));
+    AppendOption(epb, kOptEndOfOpt, "");
+    WriteBlock(kEnhancedPacketBlock, epb);
+}
+
+uint32_t PacketCapture::Drain() {
+    lock_guard<mutex> lock(file_mutex_);
+    uint32_t n = 0;
+    while (true) {
+        Slot &slot = ring_[dequeue_pos_ & (kRingSize - 1)];
+        if (slot.seq.load(memory_order_acquire) != dequeue_pos_ + 1) break;
+        WritePacket(slot);
+        slot.seq.store(dequeue_pos_ + kRingSize, memory_order_release);
+        dequeue_pos_++;
+        n++;
+    }
+    written_.fetch_add(n, memory_order_relaxed);
+    return n;
+}
+
+void PacketCapture::WriterLoop() {
+    ThreadPlacement::Get().PlaceCurrentThread(ThreadPlacement::kHelper, "capture");
+    while (!stop_.load(memory_order_acquire)) {
+        if (Drain() == 0) {
+            fflush(file_);
+            this_thread::sleep_for(chrono::milliseconds(5));
+        }
+    }
+    Drain();
+}
+
+void PacketCapture::Stop() {
+    if (!file_) return;
+    enabled_.store(false);
+    stop_.store(true, memory_order_release);
+    if (writer_.joinable()) writer_.join();
+    fclose(file_);
+    file_ = nullptr;
+    cout << "Capture: " << written_.load() << " packets written";
+    if (dropped_.load() > 0) cout << ", " << dropped_.load() << " dropped (writer fell behind)";
+    cout << endl;
+}
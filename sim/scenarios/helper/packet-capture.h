@@ -0,0 +1,120 @@
+#ifndef PACKET_CAPTURE_H
+#define PACKET_CAPTURE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ns3/packet.h"
+#include "ns3/queue-item.h"
+#include "event-log-record.h"
+
+using namespace ns3;
+
+// PacketCapture writes the packets on the simulated link to a pcapng file
+// (CaptureFile, off by default), together with what happened to them. Every
+// packet is written once, when its fate is known, with a verdict comment:
+//   forwarded:          it crossed the link,
+//   dropped-by-queue:   the queue disc dropped it,
+//   dropped-by-model:   the receive error model dropped it.
+// Further comments carry what the error model did to the packet, taken from
+// the per-packet event log records it created in the process, e.g.
+// corrupted-at-offset=12 or rebound-to=193.167.0.57:4433.
+//
+// Like the EventLog, the capture never blocks the simulation: packets are
+// copied (up to CaptureSnapLen bytes) into a lock-free ring, which a
+// background thread drains to the file. CaptureSampling captures a fraction
+// of the packets, chosen by packet, so a sampled packet is seen at every
+// capture point.
+class PacketCapture {
+public:
+    enum Verdict : uint8_t { kForwarded = 0, kDroppedByQueue = 1, kDroppedByModel = 2 };
+
+    static PacketCapture &Get();
+
+    bool IsEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // Add an interface to the capture, e.g. one direction of the link.
+    // link_type is a LINKTYPE_ value. Call while setting up the simulation.
+    uint32_t AddInterface(const std::string &name, uint16_t link_type);
+
+    // Remember a per-packet record that an error model created for the
+    // packet it is processing. It is attached to the packet captured next
+    // on this thread. Safe to call from multiple threads.
+    void Note(const EventRecord &r);
+
+    // Capture a packet. packet starts with the link-layer header.
+    void Capture(uint32_t interface, Ptr<const Packet> packet, Verdict verdict);
+    // Capture a packet that a queue disc dropped. The link-layer header is
+    // added, so the packet looks like the ones on the link.
+    void CaptureDropped(uint32_t interface, Ptr<const QueueDiscItem> item);
+    // Capture an Ethernet frame, e.g. one processed on an I/O thread. Frames
+    // that are forwarded are only captured if there are notes for them.
+    void CaptureFrame(uint32_t interface, const uint8_t *frame, uint32_t len, Verdict verdict);
+
+    // Timestamp packets from the wall clock time of simulation time 0. Call
+    // when the simulation starts (at simulation time 0).
+    void StartClock();
+    // Timestamp packets from origin, the recorded time of simulation time 0
+    // of a replay.
+    void SetEpoch(Time origin);
+
+    // Drain the ring and close the file. Called when the simulation ends.
+    void Stop();
+
+private:
+    PacketCapture();
+    ~PacketCapture();
+    PacketCapture(const PacketCapture &) = delete;
+    PacketCapture &operator=(const PacketCapture &) = delete;
+
+    static const uint32_t kRingSize = 1 << 13; // packets, must be a power of 2
+    static const uint32_t kMaxNotes = 4;
+
+    struct Slot {
+        std::atomic<uint64_t> seq;
+        uint64_t time;  // ns since the epoch
+        uint32_t interface;
+        uint32_t orig_len, cap_len;
+        uint8_t verdict;
+        uint8_t notes;
+        EventRecord note[kMaxNotes];
+    };
+
+    bool Sample(uint64_t key) const;
+    // Reserve a slot for a packet of orig_len bytes, or return nullptr if
+    // the ring is full. Fill its data, then Commit() it.
+    Slot *Reserve(uint32_t interface, uint32_t orig_len, Verdict verdict, uint64_t &pos);
+    uint8_t *GetData(const Slot *slot);
+    void Commit(Slot *slot, uint64_t pos);
+
+    void WriterLoop();
+    uint32_t Drain();
+    static void AppendOption(std::vector<uint8_t> &body, uint16_t code, const std::string &value);
+    void WriteBlock(uint32_t type, const std::vector<uint8_t> &body);
+    void WritePacket(const Slot &slot);
+
+    std::atomic<bool> enabled_;
+    FILE *file_;
+    std::mutex file_mutex_; // the writer thread and AddInterface() write to file_
+    uint32_t snap_len_;
+    uint64_t sample_threshold_; // keys hashing below this are captured
+    uint32_t interfaces_;
+    // Wall clock (or, when replaying, recorded) time of simulation time 0.
+    std::atomic<int64_t> epoch_ns_;
+
+    Slot *ring_;
+    std::vector<uint8_t> data_; // snap_len_ bytes per slot
+    std::atomic<uint64_t> enqueue_pos_;
+    uint64_t dequeue_pos_;
+    std::atomic<uint64_t> written_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<bool> stop_;
+    std::thread writer_;
+};
+
+#endif /* PACKET_CAPTURE_H */
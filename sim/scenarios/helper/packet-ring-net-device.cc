@@ -0,0 +1,247 @@
+// The ns-3 headers go first: <linux/if_packet.h> defines PACKET_HOST etc.
+// as macros, which clash with NetDevice::PacketType.
+#include "packet-ring-net-device.h"
+
+#include "ns3/abort.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace ns3;
+using namespace std;
+
+NS_OBJECT_ENSURE_REGISTERED(PacketRingNetDevice);
+
+// With TPACKET_V3, frames in the TX ring start after the (aligned) header.
+static const size_t kTxDataOffset = TPACKET_ALIGN(sizeof(tpacket3_hdr));
+
+class PacketRingNetDevice::Reader : public FdReader {
+public:
+    Reader(PacketRingNetDevice *device) : device_(device) {}
+
+private:
+    // FdReader calls this whenever the socket is readable, i.e. when the
+    // kernel handed over a block. All frames are passed on from here, so
+    // there's never a single frame to return.
+    FdReader::Data DoRead() override {
+        device_->ReceiveBlocks();
+        return FdReader::Data(nullptr, -1);
+    }
+
+    PacketRingNetDevice *device_;
+};
+
+TypeId PacketRingNetDevice::GetTypeId(void) {
+    static TypeId tid = TypeId("PacketRingNetDevice")
+        .SetParent<FdNetDevice>()
+        .AddConstructor<PacketRingNetDevice>()
+        .AddAttribute("RxBlockSize",
+                      "Size of a block of the RX ring, in bytes (a multiple of the page size)",
+                      UintegerValue(1 << 18),
+                      MakeUintegerAccessor(&PacketRingNetDevice::rx_block_size_),
+                      MakeUintegerChecker<uint32_t>())
+        .AddAttribute("RxBlockCount",
+                      "Number of blocks in the RX ring",
+                      UintegerValue(64),
+                      MakeUintegerAccessor(&PacketRingNetDevice::rx_block_count_),
+                      MakeUintegerChecker<uint32_t>(1))
+        .AddAttribute("RxBlockTimeout",
+                      "Time after which the kernel hands over a block that is not full (in ms)",
+                      TimeValue(MilliSeconds(1)),
+                      MakeTimeAccessor(&PacketRingNetDevice::rx_block_timeout_),
+                      MakeTimeChecker(MilliSeconds(1)))
+        .AddAttribute("TxFrameCount",
+                      "Number of frames in the TX ring",
+                      UintegerValue(1024),
+                      MakeUintegerAccessor(&PacketRingNetDevice::tx_frame_count_),
+                      MakeUintegerChecker<uint32_t>(kTxBatch));
+    return tid;
+}
+
+PacketRingNetDevice::PacketRingNetDevice()
+    : fd_(-1), ring_(nullptr), ring_size_(0), rx_block_(0), tx_ring_(nullptr),
+      tx_frame_size_(0), tx_frame_(0), tx_pending_(0), kernel_dropped_(0), buffer_size_(0) {}
+
+PacketRingNetDevice::~PacketRingNetDevice() {
+    if (ring_) munmap(ring_, ring_size_);
+    for (uint8_t *buf : buffers_) free(buf);
+}
+
+void PacketRingNetDevice::Open(const string &interface) {
+    fd_ = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    NS_ABORT_MSG_IF(fd_ < 0, "Can't create packet socket: " << strerror(errno));
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, interface.c_str(), IFNAMSIZ - 1);
+    NS_ABORT_MSG_IF(ioctl(fd_, SIOCGIFINDEX, &ifr) < 0, "Can't find interface " << interface);
+    const int ifindex = ifr.ifr_ifindex;
+    NS_ABORT_MSG_IF(ioctl(fd_, SIOCGIFMTU, &ifr) < 0, "Can't get the MTU of " << interface);
+    SetMtu(ifr.ifr_mtu);
+    // Ethernet header, a VLAN tag, and the FCS, the same as FdNetDevice.
+    buffer_size_ = ifr.ifr_mtu + 22;
+
+    int version = TPACKET_V3;
+    NS_ABORT_MSG_IF(setsockopt(fd_, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0,
+                    "TPACKET_V3 is not supported: " << strerror(errno));
+    int one = 1;
+    // Frames that the kernel can't send are skipped rather than stalling
+    // the TX ring. Bypassing the qdisc is only an optimization.
+    setsockopt(fd_, SOL_PACKET, PACKET_LOSS, &one, sizeof(one));
+    setsockopt(fd_, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one));
+
+    const uint32_t page_size = getpagesize();
+    NS_ABORT_MSG_IF(rx_block_size_ % page_size != 0,
+                    "RxBlockSize must be a multiple of the page size (" << page_size << ")");
+    struct tpacket_req3 rx;
+    memset(&rx, 0, sizeof(rx));
+    rx.tp_block_size = rx_block_size_;
+    rx.tp_block_nr = rx_block_count_;
+    // With TPACKET_V3, frames are packed into the blocks, the frame size is
+    // only checked for consistency.
+    rx.tp_frame_size = TPACKET_ALIGNMENT << 7;
+    rx.tp_frame_nr = rx_block_size_ / rx.tp_frame_size * rx_block_count_;
+    rx.tp_retire_blk_tov = rx_block_timeout_.GetMilliSeconds();
+    NS_ABORT_MSG_IF(setsockopt(fd_, SOL_PACKET, PACKET_RX_RING, &rx, sizeof(rx)) < 0,
+                    "Can't set up the RX ring: " << strerror(errno));
+
+    // TX frames have a fixed size: the smallest power of 2 that fits the
+    // header and a full frame.
+    tx_frame_size_ = TPACKET_ALIGNMENT;
+    while (tx_frame_size_ < kTxDataOffset + buffer_size_) tx_frame_size_ <<= 1;
+    struct tpacket_req3 tx;
+    memset(&tx, 0, sizeof(tx));
+    tx.tp_frame_size = tx_frame_size_;
+    tx.tp_block_size = max(page_size, tx_frame_size_);
+    const uint32_t frames_per_block = tx.tp_block_size / tx_frame_size_;
+    tx.tp_block_nr = (tx_frame_count_ + frames_per_block - 1) / frames_per_block;
+    tx.tp_frame_nr = tx.tp_block_nr * frames_per_block;
+    NS_ABORT_MSG_IF(setsockopt(fd_, SOL_PACKET, PACKET_TX_RING, &tx, sizeof(tx)) < 0,
+                    "Can't set up the TX ring: " << strerror(errno));
+    tx_frame_count_ = tx.tp_frame_nr;
+
+    // The RX ring is mapped first, followed by the TX ring.
+    const size_t rx_size = (size_t)rx.tp_block_size * rx.tp_block_nr;
+    ring_size_ = rx_size + (size_t)tx.tp_block_size * tx.tp_block_nr;
+    void *p = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    NS_ABORT_MSG_IF(p == MAP_FAILED, "Can't map the packet rings: " << strerror(errno));
+    ring_ = static_cast<uint8_t *>(p);
+    tx_ring_ = ring_ + rx_size;
+
+    struct sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = ifindex;
+    NS_ABORT_MSG_IF(bind(fd_, (struct sockaddr *)&addr, sizeof(addr)) < 0,
+                    "Can't bind to " << interface << ": " << strerror(errno));
+
+    SetFileDescriptor(fd_);
+}
+
+Ptr<FdReader> PacketRingNetDevice::DoCreateFdReader() {
+    return ns3::Create<Reader>(this);
+}
+
+void PacketRingNetDevice::DoFinishStoppingDevice() {
+    if (ring_) munmap(ring_, ring_size_);
+    ring_ = nullptr;
+    tx_ring_ = nullptr;
+    fd_ = -1;
+}
+
+void PacketRingNetDevice::ReceiveBlocks() {
+    while (true) {
+        auto *block = reinterpret_cast<tpacket_block_desc *>(ring_ + (size_t)rx_block_ * rx_block_size_);
+        if (!(__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) break;
+
+        const uint32_t n = block->hdr.bh1.num_pkts;
+        uint8_t *frame = reinterpret_cast<uint8_t *>(block) + block->hdr.bh1.offset_to_first_pkt;
+        for (uint32_t i = 0; i < n; i++) {
+            auto *hdr = reinterpret_cast<tpacket3_hdr *>(frame);
+            // Like recvfrom() on a raw socket, truncate frames that don't fit.
+            const size_t len = min<size_t>(hdr->tp_snaplen, buffer_size_);
+            uint8_t *buf = AllocateBuffer(len);
+            memcpy(buf, frame + hdr->tp_mac, len);
+            ReceiveCallback(buf, len);
+            frame += hdr->tp_next_offset;
+        }
+        __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        rx_block_ = (rx_block_ + 1) % rx_block_count_;
+    }
+}
+
+uint64_t PacketRingNetDevice::GetKernelDrops() {
+    // Reading the statistics resets them.
+    tpacket_stats_v3 stats;
+    socklen_t len = sizeof(stats);
+    if (fd_ >= 0 && getsockopt(fd_, SOL_PACKET, PACKET_STATISTICS, &stats, &len) == 0)
+        kernel_dropped_ += stats.tp_drops;
+    return kernel_dropped_;
+}
+
+ssize_t PacketRingNetDevice::Write(uint8_t *buffer, size_t length) {
+    if (!tx_ring_ || length > buffer_size_) {
+        errno = EINVAL;
+        return -1;
+    }
+    auto *hdr = reinterpret_cast<tpacket3_hdr *>(tx_ring_ + (size_t)tx_frame_ * tx_frame_size_);
+    if (__atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE) & (TP_STATUS_SEND_REQUEST | TP_STATUS_SENDING)) {
+        // The ring is full. The frame is dropped, like with a full socket buffer.
+        FlushTx();
+        errno = ENOBUFS;
+        return -1;
+    }
+    memcpy(reinterpret_cast<uint8_t *>(hdr) + kTxDataOffset, buffer, length);
+    hdr->tp_next_offset = 0;
+    hdr->tp_len = length;
+    hdr->tp_snaplen = length;
+    __atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+    tx_frame_ = (tx_frame_ + 1) % tx_frame_count_;
+
+    // Write() is called on the simulator thread. Kick the kernel once after
+    // all events of this point in time ran, or when the batch is full.
+    if (tx_pending_++ == 0) Simulator::ScheduleNow(&PacketRingNetDevice::FlushTx, this);
+    if (tx_pending_ >= kTxBatch) FlushTx();
+    return length;
+}
+
+void PacketRingNetDevice::FlushTx() {
+    if (tx_pending_ == 0 || fd_ < 0) return;
+    tx_pending_ = 0;
+    // Errors show up as frames that are never sent, there's nothing to do
+    // about them here.
+    send(fd_, nullptr, 0, MSG_DONTWAIT);
+}
+
+uint8_t *PacketRingNetDevice::AllocateBuffer(size_t len) {
+    NS_ABORT_MSG_IF(len > buffer_size_, "Frame of " << len << " bytes doesn't fit the MTU");
+    {
+        lock_guard<mutex> lock(buffers_mutex_);
+        if (!buffers_.empty()) {
+            uint8_t *buf = buffers_.back();
+            buffers_.pop_back();
+            return buf;
+        }
+    }
+    return static_cast<uint8_t *>(malloc(buffer_size_));
+}
+
+void PacketRingNetDevice::FreeBuffer(uint8_t *buf) {
+    if (!buf) return;
+    lock_guard<mutex> lock(buffers_mutex_);
+    buffers_.push_back(buf);
+}
@@ -0,0 +1,81 @@
+#ifndef PACKET_RING_NET_DEVICE_H
+#define PACKET_RING_NET_DEVICE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ns3/fd-net-device.h"
+#include "ns3/unix-fd-reader.h"
+
+using namespace ns3;
+
+// PacketRingNetDevice is a drop-in replacement for the FdNetDevice that
+// EmuFdNetDeviceHelper creates for eth0 / eth1. Instead of a recvfrom() and a
+// write() per frame, it uses the memory-mapped TPACKET_V3 rings of an
+// AF_PACKET socket:
+//  - The kernel fills the RX ring in blocks. The reader thread wakes up once
+//    per block, and hands all frames of the block to the simulator.
+//  - Frames are sent by copying them into the TX ring. The kernel is kicked
+//    once for all frames written in the same simulator event, or when
+//    kTxBatch frames are pending.
+// Frames are copied into (and out of) buffers from a free list, so the
+// device doesn't allocate memory per packet.
+//
+// A block is handed to the reader when it is full, or after RxBlockTimeout.
+// At low packet rates, the timeout adds up to that much delay to every
+// received packet, so this device is meant for high-bandwidth scenarios.
+class PacketRingNetDevice : public FdNetDevice {
+public:
+    static TypeId GetTypeId(void);
+    PacketRingNetDevice();
+    ~PacketRingNetDevice();
+
+    // Open a packet socket on the interface and map its rings. Aborts if
+    // that's not possible.
+    void Open(const std::string &interface);
+    // Frames the kernel dropped because the RX ring was full, since Open().
+    uint64_t GetKernelDrops();
+
+protected:
+    uint8_t *AllocateBuffer(size_t len) override;
+    void FreeBuffer(uint8_t *buf) override;
+
+private:
+    class Reader;
+
+    Ptr<FdReader> DoCreateFdReader() override;
+    void DoFinishStoppingDevice() override;
+    ssize_t Write(uint8_t *buffer, size_t length) override;
+
+    // Called on the reader thread: pass the frames of all blocks the kernel
+    // handed over to the simulator, and return the blocks to the kernel.
+    void ReceiveBlocks();
+    // Ask the kernel to send the frames in the TX ring.
+    void FlushTx();
+
+    static const uint32_t kTxBatch = 64;
+
+    uint32_t rx_block_size_;
+    uint32_t rx_block_count_;
+    Time rx_block_timeout_;
+    uint32_t tx_frame_count_;
+
+    int fd_;
+    uint8_t *ring_;
+    size_t ring_size_;
+    uint32_t rx_block_;   // the next block to read, only used by the reader
+    uint8_t *tx_ring_;
+    uint32_t tx_frame_size_;
+    uint32_t tx_frame_;   // the next frame to write
+    uint32_t tx_pending_; // frames written since the last kick
+
+    uint64_t kernel_dropped_;
+
+    size_t buffer_size_;
+    std::mutex buffers_mutex_;
+    std::vector<uint8_t *> buffers_;
+};
+
+#endif /* PACKET_RING_NET_DEVICE_H */
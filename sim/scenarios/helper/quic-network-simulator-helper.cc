@@ -1,8 +1,15 @@
+#include <atomic>
 #include <cassert>
+#include <cctype>
+#include <cerrno>
 #include <csignal>
+#include <ifaddrs.h>
+#include <map>
+#include <set>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sstream>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -14,21 +21,227 @@
 #include "ns3/fd-net-device-module.h"
 #include "ns3/internet-module.h"
 #include "quic-network-simulator-helper.h"
+#include "control-socket.h"
+#include "emu-fd-net-device.h"
+#include "event-log.h"
+#include "hybrid-synchronizer.h"
+#include "impairment-pipeline.h"
+#include "l2-bridge.h"
+#include "lag-monitor.h"
+#include "loss-report.h"
+#include "mmsg-net-device.h"
+#include "nat-table.h"
+#include "packet-capture.h"
+#include "random-source.h"
+#include "packet-ring-net-device.h"
+#include "replay-net-device.h"
+#include "thread-placement.h"
 
 using namespace ns3;
 
+static GlobalValue g_interfaces = GlobalValue("Interfaces",
+    "The interfaces that connect the endpoints to the simulator, e.g. eth0,eth1,eth2,eth3 "
+    "(empty: all interfaces with an address in 193.167.0.0/16)",
+    StringValue(""), MakeStringChecker());
+
+static GlobalValue g_netDevice = GlobalValue("NetDevice",
+    "How frames are read from and written to eth0 and eth1: emu (a raw socket, one frame per system call) "
+    "packet-ring (memory-mapped TPACKET_V3 rings, for high-bandwidth scenarios) "
+    "or mmsg (recvmmsg / sendmmsg on dedicated reader and writer threads)",
+    StringValue("emu"), MakeStringChecker());
+
+static GlobalValue g_netDeviceCpus = GlobalValue("NetDeviceCpus",
+    "With --NetDevice=mmsg, the cores to pin the I/O threads to, overriding IoCpus: "
+    "eth0 reader,eth0 writer,eth1 reader,eth1 writer,... in the order of the interfaces (-1 or empty: don't pin)",
+    StringValue(""), MakeStringChecker());
+
+static GlobalValue g_parallelImpairments = GlobalValue("ParallelImpairments",
+    "With --NetDevice=mmsg, apply the impairments of each direction on the reader threads "
+    "of the interfaces it starts at, in parallel, rather than on the simulator thread",
+    BooleanValue(false), MakeBooleanChecker());
+
+static GlobalValue g_bridge = GlobalValue("Bridge",
+    "Forward packets directly between eth0 / eth1 and the simulated link, "
+    "bypassing the IP stacks of the simulated nodes",
+    BooleanValue(false), MakeBooleanChecker());
+
+static GlobalValue g_replayLeft = GlobalValue("ReplayLeft",
+    "Instead of running in real time on eth0 / eth1, replay the frames that the client sent "
+    "in this pcap file (e.g. a trace_node_left.pcap)",
+    StringValue(""), MakeStringChecker());
+
+static GlobalValue g_replayRight = GlobalValue("ReplayRight",
+    "Instead of running in real time on eth0 / eth1, replay the frames that the server sent "
+    "in this pcap file (e.g. a trace_node_right.pcap)",
+    StringValue(""), MakeStringChecker());
+
+static GlobalValue g_replayOutput = GlobalValue("ReplayOutput",
+    "When replaying, write the frames of both interfaces to <prefix>_node_left.pcap and <prefix>_node_right.pcap",
+    StringValue("replay"), MakeStringChecker());
+
+// An interface that connects endpoints to the simulator.
+struct EmuInterface {
+  std::string name;
+  bool client_side;
+  Ipv4InterfaceAddress ipv4;
+  Ipv6InterfaceAddress ipv6;
+};
+
+// Orders interface names by their prefix, and then by their numeric suffix.
+struct InterfaceNameLess {
+  static size_t suffix(const std::string &name) {
+    size_t i = name.size();
+    while (i > 0 && isdigit((unsigned char)name[i - 1])) i--;
+    return i;
+  }
+  bool operator()(const std::string &a, const std::string &b) const {
+    const size_t i = suffix(a), j = suffix(b);
+    const int prefix = a.compare(0, i, b, 0, j);
+    if (prefix != 0) return prefix < 0;
+    // Without leading zeros, longer numbers are larger.
+    if (a.size() - i != b.size() - j) return a.size() - i < b.size() - j;
+    return a.compare(i, std::string::npos, b, j, std::string::npos) < 0;
+  }
+};
+
+// Finds the interfaces that connect the endpoints to the simulator. Every
+// client / server pair lives on its own pair of subnets (see
+// docker-compose.yml): the clients on 193.167.<n>.0/24 and
+// fd00:cafe:cafe:<n>::/64, for n < 100, and the servers on
+// 193.167.<n+100>.0/24 and fd00:cafe:cafe:<n+100>::/64. All client-side
+// interfaces are attached to the left node, all server-side interfaces to
+// the right node, so all pairs share the link between them.
+//
+// The interfaces are returned in the order of their names, comparing
+// numeric suffixes by value (eth2 before eth10). This order determines the
+// devices' ifindex, and their slots in --NetDeviceCpus.
+static std::vector<EmuInterface> findInterfaces() {
+  StringValue list;
+  g_interfaces.GetValue(list);
+  std::set<std::string> wanted;
+  std::stringstream ss(list.Get());
+  std::string name;
+  while (std::getline(ss, name, ','))
+    if (!name.empty()) wanted.insert(name);
+
+  struct ifaddrs *addrs;
+  NS_ABORT_MSG_IF(getifaddrs(&addrs) < 0, "Can't list the interfaces: " << strerror(errno));
+  std::map<std::string, EmuInterface, InterfaceNameLess> found;
+  for (struct ifaddrs *a = addrs; a; a = a->ifa_next) {
+    if (!a->ifa_addr || a->ifa_addr->sa_family != AF_INET) continue;
+    if (!wanted.empty() && !wanted.count(a->ifa_name)) continue;
+    const uint32_t addr = ntohl(((struct sockaddr_in *)a->ifa_addr)->sin_addr.s_addr);
+    const uint32_t mask = ntohl(((struct sockaddr_in *)a->ifa_netmask)->sin_addr.s_addr);
+    if ((addr >> 16) != (193 << 8 | 167)) continue;
+    const uint32_t subnet = (addr >> 8) & 0xff;
+    EmuInterface &iface = found[a->ifa_name];
+    iface.name = a->ifa_name;
+    iface.client_side = subnet < 100;
+    iface.ipv4 = Ipv4InterfaceAddress(Ipv4Address(addr), Ipv4Mask(mask));
+    // Unless the interface has one, use the IPv6 address that
+    // docker-compose.yml would assign.
+    iface.ipv6 = Ipv6InterfaceAddress(Ipv6Address(("fd00:cafe:cafe:" + std::to_string(subnet) + "::2").c_str()), 64);
+  }
+  for (struct ifaddrs *a = addrs; a; a = a->ifa_next) {
+    if (!a->ifa_addr || a->ifa_addr->sa_family != AF_INET6 || !found.count(a->ifa_name)) continue;
+    struct in6_addr *addr = &((struct sockaddr_in6 *)a->ifa_addr)->sin6_addr;
+    if (IN6_IS_ADDR_LINKLOCAL(addr)) continue;
+    const uint8_t *mask = ((struct sockaddr_in6 *)a->ifa_netmask)->sin6_addr.s6_addr;
+    uint8_t prefix_length = 0;
+    for (int i = 0; i < 16; i++) prefix_length += __builtin_popcount(mask[i]);
+    found[a->ifa_name].ipv6 = Ipv6InterfaceAddress(Ipv6Address(addr->s6_addr), Ipv6Prefix(prefix_length));
+  }
+  freeifaddrs(addrs);
+
+  for (const std::string &name : wanted)
+    NS_ABORT_MSG_IF(!found.count(name), "Interface " << name << " has no address in 193.167.0.0/16");
+  std::vector<EmuInterface> interfaces;
+  bool client_side = false, server_side = false;
+  for (const auto &entry : found) {
+    interfaces.push_back(entry.second);
+    client_side |= entry.second.client_side;
+    server_side |= !entry.second.client_side;
+  }
+  NS_ABORT_MSG_IF(!client_side || !server_side, "Need at least one interface on the client and one on the server side");
+  return interfaces;
+}
+
+// Returns true if the simulation replays pcap files, rather than running in
+// real time.
+static bool isReplay() {
+  StringValue left, right;
+  g_replayLeft.GetValue(left);
+  g_replayRight.GetValue(right);
+  return !left.Get().empty() || !right.Get().empty();
+}
+
+// Returns the core for the I/O thread with the given index in NetDeviceCpus.
+static int getNetDeviceCpu(unsigned int index) {
+  StringValue cpus;
+  g_netDeviceCpus.GetValue(cpus);
+  std::stringstream ss(cpus.Get());
+  std::string cpu;
+  for (unsigned int i = 0; std::getline(ss, cpu, ','); i++)
+    if (i == index && !cpu.empty()) return std::stoi(cpu);
+  return -1;
+}
+
+// The last signal received, polled on the simulator thread by checkSignal().
+static std::atomic<int> g_signal(0);
+
 void onSignal(int signum) {
-  std::cout << "Received signal: " << signum << std::endl;
-  // see https://gitlab.com/nsnam/ns-3-dev/issues/102
-  Simulator::Stop();
-  NS_FATAL_ERROR(signum);
+  // Only async-signal-safe calls here: the simulator thread stops the
+  // simulation, and Run() writes out the reports and logs. A second signal
+  // kills the simulator, in case it doesn't stop.
+  if (g_signal.exchange(signum) != 0) {
+    signal(signum, SIG_DFL);
+    raise(signum);
+  }
 }
 
-void installNetDevice(Ptr<Node> node, std::string deviceName, Mac48AddressValue macAddress, Ipv4InterfaceAddress ipv4Address, Ipv6InterfaceAddress ipv6Address) {
+void checkSignal() {
+  if (g_signal.load() != 0) {
+    Simulator::Stop();
+    return;
+  }
+  Simulator::Schedule(MilliSeconds(100), &checkSignal);
+}
+
+Ptr<NetDevice> createNetDevice(Ptr<Node> node, std::string deviceName, unsigned int index, Ipv4InterfaceAddress ipv4Address, Ipv6InterfaceAddress ipv6Address) {
+  if (isReplay()) {
+    StringValue input, output;
+    (index == 0 ? g_replayLeft : g_replayRight).GetValue(input);
+    g_replayOutput.GetValue(output);
+    Ptr<ReplayNetDevice> device = CreateObject<ReplayNetDevice>();
+    node->AddDevice(device);
+    device->Open(input.Get(), output.Get() + (index == 0 ? "_node_left.pcap" : "_node_right.pcap"), ipv4Address, ipv6Address);
+    return device;
+  }
+  StringValue type;
+  g_netDevice.GetValue(type);
+  if (type.Get() == "packet-ring") {
+    Ptr<PacketRingNetDevice> device = CreateObject<PacketRingNetDevice>();
+    node->AddDevice(device);
+    device->Open(deviceName);
+    return device;
+  }
+  if (type.Get() == "mmsg") {
+    Ptr<MmsgNetDevice> device = CreateObject<MmsgNetDevice>();
+    node->AddDevice(device);
+    device->Open(deviceName);
+    device->SetCpus(getNetDeviceCpu(2 * index), getNetDeviceCpu(2 * index + 1));
+    return device;
+  }
+  NS_ABORT_MSG_IF(type.Get() != "emu", "Unknown NetDevice: " << type.Get());
   EmuFdNetDeviceHelper emu;
+  // An FdNetDevice that reports the drops of its socket.
+  emu.SetTypeId("EmuFdNetDevice");
   emu.SetDeviceName(deviceName);
-  NetDeviceContainer devices = emu.Install(node);
-  Ptr<NetDevice> device = devices.Get(0);
+  return emu.Install(node).Get(0);
+}
+
+Ptr<NetDevice> installNetDevice(Ptr<Node> node, std::string deviceName, unsigned int index, Mac48AddressValue macAddress, Ipv4InterfaceAddress ipv4Address, Ipv6InterfaceAddress ipv6Address) {
+  Ptr<NetDevice> device = createNetDevice(node, deviceName, index, ipv4Address, ipv6Address);
   device->SetAttribute("Address", macAddress);
 
   Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
@@ -43,6 +256,7 @@ void installNetDevice(Ptr<Node> node, std::string deviceName, Mac48AddressValue
   ipv6->AddAddress(interface, ipv6Address);
   ipv6->SetMetric(interface, 1);
   ipv6->SetUp(interface);
+  return device;
 }
 
 Mac48Address getMacAddress(std::string iface) {
@@ -62,9 +276,16 @@ Mac48Address getMacAddress(std::string iface) {
   return mac;
 }
 
-QuicNetworkSimulatorHelper::QuicNetworkSimulatorHelper() {
-  GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::RealtimeSimulatorImpl"));
+QuicNetworkSimulatorHelper::QuicNetworkSimulatorHelper() : replays_running_(0), ingress_impairments_(false) {
+  // A replay runs as fast as possible.
+  if (!isReplay()) GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::RealtimeSimulatorImpl"));
+  // Without checksums, ns-3 writes a zero IPv4 header checksum into every
+  // forwarded packet. The error models don't add to this per-packet cost:
+  // QuicPacket leaves pass-through packets alone, and updates checksums of
+  // rewritten packets incrementally.
   GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
+  // Before the nodes create their random variables.
+  RandomSource::Get().Start();
 
   NodeContainer nodes;
   nodes.Create(2);
@@ -73,9 +294,63 @@ QuicNetworkSimulatorHelper::QuicNetworkSimulatorHelper() {
 
   left_node_ = nodes.Get(0);
   right_node_ = nodes.Get(1);
+  LossReport::Get().AddNode(left_node_);
+  LossReport::Get().AddNode(right_node_);
+
+  if (isReplay()) {
+    // There are no interfaces to take the MAC addresses from.
+    left_devices_.push_back(installNetDevice(left_node_, "eth0", 0, Mac48Address("02:00:00:00:00:01"), Ipv4InterfaceAddress("193.167.0.2", "255.255.255.0"), Ipv6InterfaceAddress("fd00:cafe:cafe:0::2", 64)));
+    right_devices_.push_back(installNetDevice(right_node_, "eth1", 1, Mac48Address("02:00:00:00:00:02"), Ipv4InterfaceAddress("193.167.100.2", "255.255.255.0"), Ipv6InterfaceAddress("fd00:cafe:cafe:100::2", 64)));
+    return;
+  }
 
-  installNetDevice(left_node_, "eth0", getMacAddress("eth0"), Ipv4InterfaceAddress("193.167.0.2", "255.255.255.0"), Ipv6InterfaceAddress("fd00:cafe:cafe:0::2", 64));
-  installNetDevice(right_node_, "eth1", getMacAddress("eth1"), Ipv4InterfaceAddress("193.167.100.2", "255.255.255.0"), Ipv6InterfaceAddress("fd00:cafe:cafe:100::2", 64));
+  std::vector<EmuInterface> interfaces = findInterfaces();
+  for (unsigned int i = 0; i < interfaces.size(); i++) {
+    const EmuInterface &iface = interfaces[i];
+    Ptr<NetDevice> device = installNetDevice(iface.client_side ? left_node_ : right_node_, iface.name, i, getMacAddress(iface.name), iface.ipv4, iface.ipv6);
+    (iface.client_side ? left_devices_ : right_devices_).push_back(device);
+    // Packets towards the server arrive on the client-side interfaces.
+    LossReport::Get().AddInterface(iface.name, device, iface.client_side ? "to_server" : "to_client", iface.client_side ? "to_client" : "to_server");
+    std::cout << "Using " << iface.name << " (" << (iface.client_side ? "client" : "server") << " side)" << std::endl;
+  }
+}
+
+bool QuicNetworkSimulatorHelper::SetIngressImpairments(Ptr<ImpairmentPipeline> to_client, Ptr<ImpairmentPipeline> to_server) {
+  BooleanValue parallel;
+  g_parallelImpairments.GetValue(parallel);
+  if (!parallel.Get()) return false;
+  // Packets towards the server arrive on the client-side interfaces, and
+  // vice versa.
+  std::vector<std::pair<Ptr<NetDevice>, Ptr<ImpairmentPipeline>>> filters;
+  for (Ptr<NetDevice> device : left_devices_) filters.push_back({device, to_server});
+  for (Ptr<NetDevice> device : right_devices_) filters.push_back({device, to_client});
+  // Dropped packets never reach the link. Capture them where they are dropped.
+  PacketCapture &capture = PacketCapture::Get();
+  if (capture.IsEnabled()) {
+    to_client->SetCaptureInterface(capture.AddInterface("to_client ingress", 1 /* LINKTYPE_ETHERNET */));
+    to_server->SetCaptureInterface(capture.AddInterface("to_server ingress", 1 /* LINKTYPE_ETHERNET */));
+  }
+  for (const auto &filter : filters) {
+    Ptr<MmsgNetDevice> device = DynamicCast<MmsgNetDevice>(filter.first);
+    NS_ABORT_MSG_IF(!device, "--ParallelImpairments needs --NetDevice=mmsg");
+    if (!filter.second->IsEmpty())
+      device->SetIngressFilter(MakeCallback(&ImpairmentPipeline::ProcessFrame, filter.second));
+  }
+  std::cout << "Applying the impairments as packets arrive from the endpoints, before the link and its queue (--ParallelImpairments)" << std::endl;
+  ingress_impairments_ = true;
+  return true;
+}
+
+// Returns the device of local that is connected to peer by a point-to-point
+// link.
+static Ptr<NetDevice> findLinkDevice(Ptr<Node> local, Ptr<Node> peer) {
+  for (uint32_t i = 0; i < local->GetNDevices(); i++) {
+    Ptr<NetDevice> device = local->GetDevice(i);
+    if (!device->IsPointToPoint() || !device->GetChannel()) continue;
+    for (std::size_t j = 0; j < device->GetChannel()->GetNDevices(); j++)
+      if (device->GetChannel()->GetDevice(j)->GetNode() == peer) return device;
+  }
+  return nullptr;
 }
 
 void massageIpv6Routing(Ptr<Node> local, Ptr<Node> peer) {
@@ -95,6 +370,9 @@ done:
 }
 
 void QuicNetworkSimulatorHelper::Run(Time duration) {
+  BooleanValue parallel;
+  g_parallelImpairments.GetValue(parallel);
+  NS_ABORT_MSG_IF(parallel.Get() && !ingress_impairments_, "--ParallelImpairments is only supported by the impairments and composed scenarios");
   signal(SIGTERM, onSignal);
   signal(SIGINT, onSignal);
   signal(SIGKILL, onSignal);
@@ -110,9 +388,45 @@ void QuicNetworkSimulatorHelper::Run(Time duration) {
   Ipv4RoutingHelper::PrintRoutingTableAllAt(Seconds(0.), routingStream);
   Ipv6RoutingHelper::PrintRoutingTableAllAt(Seconds(0.), routingStream);
 
+  BooleanValue bridge;
+  g_bridge.GetValue(bridge);
+  if (bridge.Get()) {
+    Ptr<NetDevice> left_link = findLinkDevice(left_node_, right_node_);
+    Ptr<NetDevice> right_link = findLinkDevice(right_node_, left_node_);
+    NS_ABORT_MSG_IF(!left_link || !right_link, "--Bridge needs a point-to-point link between the left and the right node");
+    // The bridges take over the receive callbacks of the link devices.
+    NS_ABORT_MSG_IF(left_devices_.size() != 1 || right_devices_.size() != 1, "--Bridge supports a single client / server pair");
+    left_bridge_ = Create<L2Bridge>(left_devices_[0], left_link);
+    right_bridge_ = Create<L2Bridge>(right_devices_[0], right_link);
+  }
+
   Simulator::Stop(duration);
-  RunSynchronizer();
+  if (isReplay()) {
+    StartReplay();
+  } else {
+    RunSynchronizer();
+    // Real-time simulation time 0 is when Simulator::Run() starts.
+    Simulator::Schedule(Seconds(0), &PacketCapture::StartClock, &PacketCapture::Get());
+  }
+  // Set up the event log before locking memory.
+  EventLog::Get();
+  ThreadPlacement::Get().Setup();
+  // The FdNetDevice reader threads only start with the simulation.
+  Simulator::Schedule(MilliSeconds(1), &ThreadPlacement::PlaceOtherThreadsAndReport, &ThreadPlacement::Get());
+  HybridSynchronizer::Install();
+  LagMonitor::Get().Start();
+  LossReport::Get().Start();
+  ControlSocket::Get().Start();
+  checkSignal();
   Simulator::Run();
+  if (g_signal.load() != 0) std::cout << "Received signal: " << g_signal.load() << std::endl;
+  ControlSocket::Get().Stop();
+  LagMonitor::Get().Report();
+  HybridSynchronizer::Report();
+  LossReport::Get().Report();
+  NatTable::ReportAll();
+  EventLog::Get().Stop();
+  PacketCapture::Get().Stop();
   Simulator::Destroy();
 }
 
@@ -134,6 +448,24 @@ void QuicNetworkSimulatorHelper::RunSynchronizer() const {
   listen(sockfd, 100);
 }
 
+void QuicNetworkSimulatorHelper::StartReplay() {
+  Ptr<ReplayNetDevice> left = DynamicCast<ReplayNetDevice>(left_devices_[0]);
+  Ptr<ReplayNetDevice> right = DynamicCast<ReplayNetDevice>(right_devices_[0]);
+  // Keep the timing between the two recordings.
+  const Time origin = std::min(left->GetFirstTimestamp(), right->GetFirstTimestamp());
+  // Timestamp the capture like the replay output.
+  PacketCapture::Get().SetEpoch(origin);
+  replays_running_ = 2;
+  left->Start(origin, MakeCallback(&QuicNetworkSimulatorHelper::OnReplayDone, this));
+  right->Start(origin, MakeCallback(&QuicNetworkSimulatorHelper::OnReplayDone, this));
+}
+
+void QuicNetworkSimulatorHelper::OnReplayDone() {
+  if (--replays_running_ > 0) return;
+  // Give the last packets time to cross the link.
+  Simulator::Stop(Seconds(5));
+}
+
 Ptr<Node> QuicNetworkSimulatorHelper::GetLeftNode() const {
   return left_node_;
 }
@@ -1,20 +1,39 @@
 #ifndef QUIC_NETWORK_SIMULATOR_HELPER_H
 #define QUIC_NETWORK_SIMULATOR_HELPER_H
 
+#include <vector>
+
+#include "ns3/net-device.h"
 #include "ns3/node.h"
+#include "l2-bridge.h"
 
 using namespace ns3;
 
+class ImpairmentPipeline;
+
 class QuicNetworkSimulatorHelper {
 public:
   QuicNetworkSimulatorHelper();
   void Run(Time);
   Ptr<Node> GetLeftNode() const;
   Ptr<Node> GetRightNode() const;
+  // With --ParallelImpairments, run the pipeline of each direction on the
+  // reader threads of the interfaces its packets arrive on, instead of on
+  // the link. Returns false if the option is off: install the pipelines on
+  // the link then. Run() aborts if the option is on, and the scenario
+  // doesn't call this.
+  bool SetIngressImpairments(Ptr<ImpairmentPipeline> to_client, Ptr<ImpairmentPipeline> to_server);
 
 private:
   void RunSynchronizer() const;
+  void StartReplay();
+  void OnReplayDone();
   Ptr<Node> left_node_, right_node_;
+  // The interfaces to the clients and the servers.
+  std::vector<Ptr<NetDevice>> left_devices_, right_devices_;
+  Ptr<L2Bridge> left_bridge_, right_bridge_;
+  int replays_running_;
+  bool ingress_impairments_;
 };
 
 #endif /* QUIC_NETWORK_SIMULATOR_HELPER_H */
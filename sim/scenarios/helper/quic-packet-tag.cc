@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <iostream>
+
+#include "quic-packet-tag.h"
+
+using namespace ns3;
+using namespace std;
+
+NS_OBJECT_ENSURE_REGISTERED(QuicPacketTag);
+
+static inline uint16_t Read16(const uint8_t *b) {
+    return (b[0] << 8) | b[1];
+}
+
+TypeId QuicPacketTag::GetTypeId(void) {
+    static TypeId tid = TypeId("QuicPacketTag")
+        .SetParent<Tag>()
+        .AddConstructor<QuicPacketTag>()
+        ;
+    return tid;
+}
+
+TypeId QuicPacketTag::GetInstanceTypeId(void) const { return GetTypeId(); }
+
+QuicPacketTag::QuicPacketTag()
+    : flags_(0), udp_offset_(0), payload_offset_(0), payload_len_(0), packet_size_(0) {}
+
+QuicPacketTag QuicPacketTag::Classify(Ptr<Packet> p) {
+    QuicPacketTag tag;
+    if (p->PeekPacketTag(tag) && tag.packet_size_ == p->GetSize()) return tag;
+    uint8_t buf[kMaxClassifyLen];
+    const uint32_t len = p->CopyData(buf, sizeof(buf));
+    tag.Parse(buf, len, p->GetSize());
+    Attach(p, tag);
+    return tag;
+}
+
+QuicPacketTag QuicPacketTag::Classify(Ptr<Packet> p, const uint8_t *buf, uint32_t len) {
+    QuicPacketTag tag;
+    if (p->PeekPacketTag(tag) && tag.packet_size_ == p->GetSize()) return tag;
+    tag.Parse(buf, len, p->GetSize());
+    Attach(p, tag);
+    return tag;
+}
+
+QuicPacketTag QuicPacketTag::Refresh(Ptr<Packet> p, const uint8_t *buf, uint32_t len) {
+    QuicPacketTag tag;
+    tag.Parse(buf, len, p->GetSize());
+    Attach(p, tag);
+    return tag;
+}
+
+QuicPacketTag QuicPacketTag::ClassifyFrame(const uint8_t *buf, uint32_t len, uint32_t frame_size) {
+    QuicPacketTag tag;
+    tag.Parse(buf, len, frame_size, true);
+    return tag;
+}
+
+void QuicPacketTag::Attach(Ptr<Packet> p, QuicPacketTag &tag) {
+    // A packet can only carry one tag of each type. Overwrite a stale one.
+    if (!p->ReplacePacketTag(tag)) p->AddPacketTag(tag);
+}
+
+void QuicPacketTag::Parse(const uint8_t *buf, uint32_t len, uint32_t packet_size, bool ethernet) {
+    flags_ = 0;
+    packet_size_ = packet_size;
+    // PPP header: a 2 byte protocol field. Ethernet header: two addresses,
+    // followed by the EtherType.
+    const uint32_t ip_offset = ethernet ? 14 : 2;
+    if (len < ip_offset) return;
+    const uint8_t *ip = &buf[ip_offset];
+    uint32_t udp_offset;
+    uint16_t protocol = Read16(&buf[ip_offset - 2]);
+    if (ethernet) {
+        // Map the EtherType to the PPP protocol. Anything else (e.g. ARP) is
+        // not a UDP packet.
+        if (protocol == 0x0800) protocol = 0x21;
+        else if (protocol == 0x86dd) protocol = 0x57;
+        else return;
+    }
+    switch (protocol) {
+        case 0x21: // IPv4
+            {
+                if (len < ip_offset + 20) return;
+                const uint32_t ip_hdr_len = (ip[0] & 0x0f) * 4;
+                if ((ip[0] >> 4) != 4 || ip_hdr_len < 20 || ip[9] != 17) return;
+                // Only the first fragment carries the UDP header.
+                if ((Read16(&ip[6]) & 0x1fff) != 0) return;
+                udp_offset = ip_offset + ip_hdr_len;
+            }
+            break;
+        case 0x57: // IPv6
+            // Extension headers are not supported, the next header must be UDP.
+            if (len < ip_offset + 40) return;
+            if ((ip[0] >> 4) != 6 || ip[6] != 17) return;
+            udp_offset = ip_offset + 40;
+            flags_ |= kIpv6;
+            break;
+        default:
+            cout << "Unknown PPP protocol: " << protocol << endl;
+            return;
+    }
+    const uint32_t payload_offset = udp_offset + 8;
+    if (len < payload_offset) return;
+    const uint16_t udp_len = Read16(&buf[udp_offset + 4]);
+    if (udp_len < 8 || udp_offset + udp_len > packet_size) return;
+    udp_offset_ = udp_offset;
+    payload_offset_ = payload_offset;
+    payload_len_ = udp_len - 8;
+    flags_ |= kUdp;
+
+    const uint8_t *payload = &buf[payload_offset];
+    const uint32_t prefix = min<uint32_t>(payload_len_, len - payload_offset);
+    if (prefix > 0 && (payload[0] & 0x80)) flags_ |= kQuicLongHeader;
+    if (prefix > 5 && payload[1] == 0 && payload[2] == 0 && payload[3] == 0 && payload[4] == 0)
+        flags_ |= kVersionNegotiation;
+}
+
+bool QuicPacketTag::IsUdp() const { return flags_ & kUdp; }
+
+bool QuicPacketTag::IsIpv6() const { return flags_ & kIpv6; }
+
+bool QuicPacketTag::IsQuicLongHeader() const { return flags_ & kQuicLongHeader; }
+
+bool QuicPacketTag::IsVersionNegotiation() const { return flags_ & kVersionNegotiation; }
+
+uint32_t QuicPacketTag::GetUdpOffset() const { return udp_offset_; }
+
+uint32_t QuicPacketTag::GetPayloadOffset() const { return payload_offset_; }
+
+uint32_t QuicPacketTag::GetPayloadSize() const { return payload_len_; }
+
+uint32_t QuicPacketTag::GetSerializedSize(void) const { return 1 + 1 + 1 + 2 + 4; }
+
+void QuicPacketTag::Serialize(TagBuffer i) const {
+    i.WriteU8(flags_);
+    i.WriteU8(udp_offset_);
+    i.WriteU8(payload_offset_);
+    i.WriteU16(payload_len_);
+    i.WriteU32(packet_size_);
+}
+
+void QuicPacketTag::Deserialize(TagBuffer i) {
+    flags_ = i.ReadU8();
+    udp_offset_ = i.ReadU8();
+    payload_offset_ = i.ReadU8();
+    payload_len_ = i.ReadU16();
+    packet_size_ = i.ReadU32();
+}
+
+void QuicPacketTag::Print(std::ostream &os) const {
+    if (!IsUdp()) {
+        os << "not UDP";
+        return;
+    }
+    os << (IsIpv6() ? "IPv6" : "IPv4") << " UDP, payload " << payload_len_ << " bytes at " << (uint32_t)payload_offset_;
+    if (IsQuicLongHeader()) os << ", QUIC long header";
+    if (IsVersionNegotiation()) os << ", version negotiation";
+}
@@ -0,0 +1,75 @@
+#ifndef QUIC_PACKET_TAG_H
+#define QUIC_PACKET_TAG_H
+
+#include <cstdint>
+
+#include "ns3/packet.h"
+#include "ns3/tag.h"
+
+using namespace ns3;
+
+// QuicPacketTag caches the classification of a PPP / IPv4 or IPv6 / UDP
+// frame: whether it is a UDP packet, the header offsets, and a few QUIC
+// header bits. The headers are parsed by the first error model (or queue
+// disc, ...) that looks at a packet, and the result is attached as a packet
+// tag, so that later stages on the path don't have to parse them again.
+//
+// The tag records the size of the packet it was computed for. If the packet
+// changed size since then (e.g. a hop added or removed headers), the tag is
+// considered stale and the packet is parsed again.
+class QuicPacketTag : public Tag {
+public:
+    // Bytes that need to be looked at to classify a packet:
+    // PPP + IPv4 (with options) + UDP + the first bytes of a QUIC header.
+    static const uint32_t kMaxClassifyLen = 2 + 60 + 8 + 5;
+
+    static TypeId GetTypeId(void);
+    QuicPacketTag();
+
+    // Returns the classification of p, parsing the headers only if p doesn't
+    // carry a valid tag yet.
+    static QuicPacketTag Classify(Ptr<Packet> p);
+    // Same as above, for callers that already copied the first len bytes of
+    // the packet to buf.
+    static QuicPacketTag Classify(Ptr<Packet> p, const uint8_t *buf, uint32_t len);
+    // Reclassify p after it was modified. buf holds its first len bytes.
+    static QuicPacketTag Refresh(Ptr<Packet> p, const uint8_t *buf, uint32_t len);
+    // Classify an Ethernet frame (instead of a PPP frame) of frame_size
+    // bytes, that is not wrapped in a packet. buf holds its first len bytes.
+    static QuicPacketTag ClassifyFrame(const uint8_t *buf, uint32_t len, uint32_t frame_size);
+
+    // True if the packet is a well-formed UDP packet.
+    // The offsets and the QUIC bits are only meaningful if it is.
+    bool IsUdp() const;
+    bool IsIpv6() const;
+    bool IsQuicLongHeader() const;
+    bool IsVersionNegotiation() const;
+    uint32_t GetUdpOffset() const;
+    uint32_t GetPayloadOffset() const;
+    uint32_t GetPayloadSize() const;
+
+    TypeId GetInstanceTypeId(void) const;
+    uint32_t GetSerializedSize(void) const;
+    void Serialize(TagBuffer i) const;
+    void Deserialize(TagBuffer i);
+    void Print(std::ostream &os) const;
+
+private:
+    enum Flags {
+        kUdp = 1 << 0,
+        kIpv6 = 1 << 1,
+        kQuicLongHeader = 1 << 2,
+        kVersionNegotiation = 1 << 3,
+    };
+
+    void Parse(const uint8_t *buf, uint32_t len, uint32_t packet_size, bool ethernet = false);
+    static void Attach(Ptr<Packet> p, QuicPacketTag &tag);
+
+    uint8_t flags_;
+    uint8_t udp_offset_;
+    uint8_t payload_offset_;
+    uint16_t payload_len_;
+    uint32_t packet_size_;
+};
+
+#endif /* QUIC_PACKET_TAG_H */
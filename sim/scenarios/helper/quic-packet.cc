@@ -1,85 +1,354 @@
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <vector>
 
 #include "quic-packet.h"
+#include "quic-packet-tag.h"
 
+#include "ns3/boolean.h"
+#include "ns3/global-value.h"
 #include "ns3/packet.h"
-#include "ns3/ppp-header.h"
-#include "ns3/ipv4-header.h"
-#include "ns3/ipv6-header.h"
-#include "ns3/udp-header.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
 
 using namespace ns3;
 using namespace std;
 
+// QuicPacketPrefix serializes a raw run of bytes.
+// It is used to write the modified front of a packet back in place:
+// removing n bytes from the start of a packet and adding n bytes again
+// reuses the packet's buffer instead of copying the payload.
+class QuicPacketPrefix : public Header {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("QuicPacketPrefix")
+            .SetParent<Header>()
+            ;
+        return tid;
+    }
+    QuicPacketPrefix(const uint8_t *data, uint32_t len) : data_(data), len_(len) {}
+    TypeId GetInstanceTypeId(void) const { return GetTypeId(); }
+    void Print(std::ostream &os) const { os << "prefix " << len_ << " bytes"; }
+    uint32_t GetSerializedSize(void) const { return len_; }
+    void Serialize(Buffer::Iterator start) const { start.Write(data_, len_); }
+    uint32_t Deserialize(Buffer::Iterator start) { return 0; }
+
+private:
+    const uint8_t *data_;
+    uint32_t len_;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(QuicPacketPrefix);
+
+// By default, rewrites update the IP and UDP checksums incrementally.
+// Recomputing them over the whole packet is only useful for debugging.
+static GlobalValue g_fullChecksum = GlobalValue("QuicPacketFullChecksum",
+    "Recompute IP and UDP checksums over the whole packet after a rewrite, instead of updating them incrementally",
+    BooleanValue(false), MakeBooleanChecker());
+
+static bool ReadFullChecksum() {
+    BooleanValue v;
+    g_fullChecksum.GetValue(v);
+    return v.Get();
+}
+
+static bool UseFullChecksum() {
+    // Frames are processed on I/O threads as well.
+    static const bool full = ReadFullChecksum();
+    return full;
+}
+
+static inline uint16_t Read16(const uint8_t *b) {
+    return (b[0] << 8) | b[1];
+}
+
+static inline void Write16(uint8_t *b, uint16_t v) {
+    b[0] = v >> 8;
+    b[1] = v & 0xff;
+}
+
+// One's complement sum of big-endian 16-bit words (RFC 1071).
+static uint32_t ChecksumAdd(uint32_t sum, const uint8_t *data, uint32_t len) {
+    while (len > 1) {
+        sum += Read16(data);
+        data += 2;
+        len -= 2;
+    }
+    if (len > 0) sum += data[0] << 8;
+    return sum;
+}
+
+static uint16_t ChecksumFold(uint32_t sum) {
+    while (sum >> 16) sum = (sum & 0xffff) + (sum >> 16);
+    return ~sum & 0xffff;
+}
+
+// Update checksum hc after the 16-bit word m changed to m_new (RFC 1624, eqn. 3).
+static uint16_t ChecksumUpdate(uint16_t hc, uint16_t m, uint16_t m_new) {
+    uint32_t sum = (uint16_t)~hc + (uint16_t)~m + m_new;
+    return ChecksumFold(sum);
+}
+
 
 bool IsUDPPacket(Ptr<Packet> p) {
-    PppHeader ppp_hdr = PppHeader();
-    p->RemoveHeader(ppp_hdr);
-    bool is_udp = false;
-    switch(ppp_hdr.GetProtocol()) {
-        case 0x21: // IPv4
-            {
-                Ipv4Header hdr = Ipv4Header();
-                p->PeekHeader(hdr);
-                is_udp = hdr.GetProtocol() == 17;
-            }
-            break;
-        case 0x57: // IPv6
-            {
-                Ipv6Header hdr = Ipv6Header();
-                p->PeekHeader(hdr);
-                is_udp = hdr.GetNextHeader() == 17;
-            }
-            break;
-        default:
-            cout << "Unknown PPP protocol: " << ppp_hdr.GetProtocol() << endl;
-            break;
+    return QuicPacketTag::Classify(p).IsUdp();
+}
+
+QuicPacket::QuicPacket(Ptr<Packet> p)
+    : p_(p), frame_(nullptr), frame_len_(0), buf_len_(0), ip_offset_(0), addr_offset_(0), addr_len_(0),
+      udp_offset_(0), payload_offset_(0), payload_len_(0), dirty_end_(0),
+      ipv6_(false), full_checksum_(false), valid_(false) {
+    // Only copy the front of the packet. The payload stays where it is.
+    buf_len_ = p->CopyData(buf_, sizeof(buf_));
+    // The headers were most likely classified already, by IsUDPPacket().
+    const QuicPacketTag tag = QuicPacketTag::Classify(p, buf_, buf_len_);
+    if (!tag.IsUdp()) return;
+    ip_offset_ = 2;
+    ipv6_ = tag.IsIpv6();
+    addr_offset_ = ip_offset_ + (ipv6_ ? 8 : 12);
+    addr_len_ = ipv6_ ? 16 : 4;
+    udp_offset_ = tag.GetUdpOffset();
+    payload_offset_ = tag.GetPayloadOffset();
+    payload_len_ = tag.GetPayloadSize();
+    valid_ = true;
+}
+
+QuicPacket::QuicPacket(uint8_t *frame, uint32_t len)
+    : frame_(frame), frame_len_(len), buf_len_(0), ip_offset_(0), addr_offset_(0), addr_len_(0),
+      udp_offset_(0), payload_offset_(0), payload_len_(0), dirty_end_(0),
+      ipv6_(false), full_checksum_(false), valid_(false) {
+    buf_len_ = CopyData(buf_, sizeof(buf_));
+    const QuicPacketTag tag = QuicPacketTag::ClassifyFrame(buf_, buf_len_, len);
+    if (!tag.IsUdp()) return;
+    ip_offset_ = 14;
+    ipv6_ = tag.IsIpv6();
+    addr_offset_ = ip_offset_ + (ipv6_ ? 8 : 12);
+    addr_len_ = ipv6_ ? 16 : 4;
+    udp_offset_ = tag.GetUdpOffset();
+    payload_offset_ = tag.GetPayloadOffset();
+    payload_len_ = tag.GetPayloadSize();
+    valid_ = true;
+}
+
+uint32_t QuicPacket::CopyData(uint8_t *dst, uint32_t len) const {
+    if (p_) return p_->CopyData(dst, len);
+    len = min(len, frame_len_);
+    memcpy(dst, frame_, len);
+    return len;
+}
+
+bool QuicPacket::IsValid() const { return valid_; }
+
+bool QuicPacket::IsIpv6() const { return ipv6_; }
+
+Address QuicPacket::GetAddress(uint32_t offset) const {
+    if (ipv6_) return Ipv6Address::Deserialize(&buf_[offset]);
+    return Ipv4Address::Deserialize(&buf_[offset]);
+}
+
+void QuicPacket::SetAddress(uint32_t offset, const Address &addr) {
+    uint8_t b[16];
+    if (ipv6_) {
+        NS_ASSERT(Ipv6Address::IsMatchingType(addr));
+        Ipv6Address::ConvertFrom(addr).Serialize(b);
+    } else {
+        NS_ASSERT(Ipv4Address::IsMatchingType(addr));
+        Ipv4Address::ConvertFrom(addr).Serialize(b);
     }
-    p->AddHeader(ppp_hdr);
-    return is_udp;
+    Rewrite(offset, b, addr_len_);
 }
 
+Address QuicPacket::GetSource() const { return GetAddress(addr_offset_); }
 
-QuicPacket::QuicPacket(Ptr<Packet> p) : p_(p) {
-    const uint32_t p_len = p->GetSize();
-    uint8_t *buffer= new uint8_t[p_len];
-    p->CopyData(buffer, p_len);
-    ppp_hdr_ = PppHeader();
-    uint32_t ppp_hdr_len = p->RemoveHeader(ppp_hdr_);
-    // TODO: This currently only works for IPv4.
-    ipv4_hdr_ = Ipv4Header();
-    uint32_t ip_hdr_len = p->RemoveHeader(ipv4_hdr_);
-    udp_hdr_ = UdpHeader();
-    udp_hdr_len_ = p->RemoveHeader(udp_hdr_);
-    total_hdr_len_ = ppp_hdr_len + ip_hdr_len + udp_hdr_len_;
-    udp_payload_ = vector<uint8_t>(&buffer[total_hdr_len_], &buffer[total_hdr_len_] + p_len - total_hdr_len_);
+Address QuicPacket::GetDestination() const { return GetAddress(addr_offset_ + addr_len_); }
+
+uint16_t QuicPacket::GetSourcePort() const { return Read16(&buf_[udp_offset_]); }
+
+uint16_t QuicPacket::GetDestinationPort() const { return Read16(&buf_[udp_offset_ + 2]); }
+
+void QuicPacket::SetSource(const Address &addr) { SetAddress(addr_offset_, addr); }
+
+void QuicPacket::SetDestination(const Address &addr) { SetAddress(addr_offset_ + addr_len_, addr); }
+
+void QuicPacket::SetSourcePort(uint16_t port) {
+    uint8_t b[2];
+    Write16(b, port);
+    Rewrite(udp_offset_, b, 2);
+}
+
+void QuicPacket::SetDestinationPort(uint16_t port) {
+    uint8_t b[2];
+    Write16(b, port);
+    Rewrite(udp_offset_ + 2, b, 2);
+}
+
+uint32_t QuicPacket::GetUdpPayloadSize() const { return payload_len_; }
+
+uint32_t QuicPacket::GetUdpPayloadPrefixSize() const {
+    return min(payload_len_, buf_len_ - payload_offset_);
+}
+
+uint8_t QuicPacket::GetPayloadByte(uint32_t pos) const {
+    NS_ASSERT(pos < GetUdpPayloadPrefixSize());
+    return buf_[payload_offset_ + pos];
+}
+
+void QuicPacket::SetPayloadByte(uint32_t pos, uint8_t val) {
+    NS_ASSERT(pos < GetUdpPayloadPrefixSize());
+    Rewrite(payload_offset_ + pos, &val, 1);
+    if (!udp_payload_.empty()) udp_payload_[pos] = val;
+}
+
+bool QuicPacket::IsVersionNegotiationPacket() const {
+    if(GetUdpPayloadPrefixSize() <= 5) return false;
+    const uint8_t *payload = &buf_[payload_offset_];
+    return payload[1] == 0 && payload[2] == 0 && payload[3] == 0 && payload[4] == 0;
 }
 
-Ipv4Header& QuicPacket::GetIpv4Header() { return ipv4_hdr_; }
+void QuicPacket::PrintAddress(std::ostream &os, const Address &addr) {
+    if (Ipv6Address::IsMatchingType(addr))
+        os << "[" << Ipv6Address::ConvertFrom(addr) << "]";
+    else
+        os << Ipv4Address::ConvertFrom(addr);
+}
+
+void QuicPacket::PrintFlow(std::ostream &os) const {
+    PrintAddress(os, GetSource());
+    os << ":" << GetSourcePort() << " -> ";
+    PrintAddress(os, GetDestination());
+    os << ":" << GetDestinationPort();
+}
+
+void QuicPacket::MarkDirty(uint32_t end) {
+    dirty_end_ = max(dirty_end_, end);
+}
+
+void QuicPacket::Rewrite(uint32_t offset, const uint8_t *data, uint32_t len) {
+    MarkDirty(offset + len);
+    if (UseFullChecksum()) {
+        memcpy(&buf_[offset], data, len);
+        full_checksum_ = true;
+        return;
+    }
+    // Only IPv4 has a header checksum.
+    uint16_t ip_sum = ipv6_ ? 0 : Read16(&buf_[ip_offset_ + 10]);
+    uint16_t udp_sum = Read16(&buf_[udp_offset_ + 6]);
+    // A zero UDP checksum means that the sender didn't compute one.
+    const bool has_udp_sum = udp_sum != 0;
+    for (uint32_t i = 0; i < len; i++) {
+        const uint32_t o = offset + i;
+        // IP header lengths are a multiple of 4, so a byte is the high byte
+        // of its 16-bit word in both the IP header and the UDP datagram.
+        const bool high = ((o - ip_offset_) & 1) == 0;
+        const uint16_t m = high ? buf_[o] << 8 : buf_[o];
+        const uint16_t m_new = high ? data[i] << 8 : data[i];
+        buf_[o] = data[i];
+        if (m == m_new) continue;
+        if (!ipv6_ && o < udp_offset_)
+            ip_sum = ChecksumUpdate(ip_sum, m, m_new);
+        // The UDP checksum covers the addresses through the pseudo header.
+        const bool is_addr = o >= addr_offset_ && o < addr_offset_ + 2 * addr_len_;
+        if (has_udp_sum && (o >= udp_offset_ || is_addr))
+            udp_sum = ChecksumUpdate(udp_sum, m, m_new);
+    }
+    if (!ipv6_) Write16(&buf_[ip_offset_ + 10], ip_sum);
+    // A computed checksum of zero is transmitted as all ones.
+    if (has_udp_sum) Write16(&buf_[udp_offset_ + 6], udp_sum == 0 ? 0xffff : udp_sum);
+}
+
+uint16_t QuicPacket::ComputeUdpChecksum(const uint8_t *payload, uint32_t payload_len) const {
+    // Pseudo header: source and destination address, protocol, UDP length.
+    // The IPv4 and the IPv6 pseudo header have the same sum.
+    uint32_t sum = ChecksumAdd(0, &buf_[addr_offset_], 2 * addr_len_);
+    sum += 17;
+    sum += 8 + payload_len;
+    // UDP header, with the checksum field counted as zero.
+    sum = ChecksumAdd(sum, &buf_[udp_offset_], 6);
+    sum = ChecksumAdd(sum, payload, payload_len);
+    uint16_t checksum = ChecksumFold(sum);
+    // A computed checksum of zero is transmitted as all ones.
+    return checksum == 0 ? 0xffff : checksum;
+}
 
-UdpHeader& QuicPacket::GetUdpHeader() { return udp_hdr_; }
+void QuicPacket::UpdateIpv4Checksum() {
+    if (ipv6_) return;
+    uint8_t *ip = &buf_[ip_offset_];
+    Write16(&ip[10], 0);
+    Write16(&ip[10], ChecksumFold(ChecksumAdd(0, ip, udp_offset_ - ip_offset_)));
+}
 
-vector<uint8_t>& QuicPacket::GetUdpPayload() { return udp_payload_; }
+void QuicPacket::Commit() {
+    if (!valid_ || dirty_end_ == 0) return;
+    // Incremental updates already fixed up the checksums in the prefix.
+    // Otherwise, recompute them. A zero UDP checksum means that the sender
+    // didn't compute one.
+    if (full_checksum_ && Read16(&buf_[udp_offset_ + 6]) != 0) {
+        // The checksum covers the whole payload. Sum it from a scratch copy,
+        // with the modified prefix laid over the original bytes.
+        thread_local vector<uint8_t> scratch;
+        scratch.resize(payload_offset_ + payload_len_);
+        CopyData(scratch.data(), scratch.size());
+        memcpy(scratch.data(), buf_, min<uint32_t>(buf_len_, scratch.size()));
+        Write16(&buf_[udp_offset_ + 6], ComputeUdpChecksum(&scratch[payload_offset_], payload_len_));
+    }
+    if (full_checksum_) UpdateIpv4Checksum();
+    // The checksums live in the headers, so the headers are always rewritten.
+    const bool payload_dirty = dirty_end_ > payload_offset_;
+    MarkDirty(payload_offset_);
+    if (!p_) {
+        memcpy(frame_, buf_, dirty_end_);
+        dirty_end_ = 0;
+        full_checksum_ = false;
+        return;
+    }
+    p_->RemoveAtStart(dirty_end_);
+    p_->AddHeader(QuicPacketPrefix(buf_, dirty_end_));
+    // Rewriting addresses and ports doesn't change the classification,
+    // but the QUIC header bits might have changed.
+    if (payload_dirty) QuicPacketTag::Refresh(p_, buf_, buf_len_);
+    dirty_end_ = 0;
+    full_checksum_ = false;
+}
 
-bool QuicPacket::IsVersionNegotiationPacket() {
-    if(udp_payload_.size() <= 5) return false;
-    return udp_payload_[1] == 0 && udp_payload_[2] == 0 && udp_payload_[3] == 0 && udp_payload_[4] == 0;
+vector<uint8_t>& QuicPacket::GetUdpPayload() {
+    NS_ASSERT_MSG(p_, "GetUdpPayload() is not supported for frames");
+    if (udp_payload_.empty() && payload_len_ > 0) {
+        udp_payload_.resize(payload_len_);
+        vector<uint8_t> frame(payload_offset_ + payload_len_);
+        p_->CopyData(frame.data(), frame.size());
+        memcpy(udp_payload_.data(), &frame[payload_offset_], payload_len_);
+        // Keep modifications that were already made in place.
+        memcpy(udp_payload_.data(), &buf_[payload_offset_], GetUdpPayloadPrefixSize());
+    }
+    return udp_payload_;
 }
 
 void QuicPacket::ReassemblePacket() {
-    // Start with the UDP payload.
-    Packet new_p = Packet(udp_payload_.data(), udp_payload_.size());
-    // Add the UDP header and make sure to recalculate the checksum.
-    udp_hdr_.ForcePayloadSize(udp_payload_.size() + udp_hdr_len_);
-    udp_hdr_.ForceChecksum(0);
-    udp_hdr_.InitializeChecksum(ipv4_hdr_.GetSource(), ipv4_hdr_.GetDestination(), ipv4_hdr_.GetProtocol());
-    new_p.AddHeader(udp_hdr_);
-    // Add the IP header, again make sure to recalculate the checksum.
-    ipv4_hdr_.EnableChecksum();
-    new_p.AddHeader(ipv4_hdr_);
-    // Add the PPP header.
-    new_p.AddHeader(ppp_hdr_);
+    if (!valid_) return;
+    NS_ASSERT_MSG(p_, "ReassemblePacket() is not supported for frames");
+    vector<uint8_t> &payload = GetUdpPayload();
+    // Fix up the length fields, in case the payload changed size.
+    payload_len_ = payload.size();
+    Write16(&buf_[udp_offset_ + 4], 8 + payload_len_);
+    if (ipv6_)
+        Write16(&buf_[ip_offset_ + 4], 8 + payload_len_);
+    else
+        Write16(&buf_[ip_offset_ + 2], payload_offset_ - ip_offset_ + payload_len_);
+    // Recalculate the UDP and the IP checksum.
+    if (Read16(&buf_[udp_offset_ + 6]) != 0)
+        Write16(&buf_[udp_offset_ + 6], ComputeUdpChecksum(payload.data(), payload_len_));
+    UpdateIpv4Checksum();
+    // Start with the UDP payload, and add the PPP, IP and UDP header.
+    Ptr<Packet> new_p = Create<Packet>(payload.data(), payload_len_);
+    new_p->AddHeader(QuicPacketPrefix(buf_, payload_offset_));
     p_->RemoveAtEnd(p_->GetSize());
-    p_->AddAtEnd(Ptr<Packet>(&new_p));
+    p_->AddAtEnd(new_p);
+    // Resynchronize the in-place prefix with the new payload.
+    const uint32_t prefix = min<uint32_t>(payload_len_, kMaxPayloadPrefix);
+    memcpy(&buf_[payload_offset_], payload.data(), prefix);
+    buf_len_ = payload_offset_ + prefix;
+    QuicPacketTag::Refresh(p_, buf_, buf_len_);
+    dirty_end_ = 0;
+    full_checksum_ = false;
 }
@@ -2,37 +2,111 @@
 #define QUIC_PACKET_H
 
 #include <cstdint>
+#include <vector>
 
 #include "ns3/header.h"
 #include "ns3/packet.h"
-#include "ns3/ppp-header.h"
-#include "ns3/ipv4-header.h"
-#include "ns3/udp-header.h"
+#include "ns3/address.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
 
 using namespace ns3;
 using namespace std;
 
+// IsUDPPacket classifies the packet once and caches the result in a
+// QuicPacketTag, which QuicPacket (and later error models) reuse.
 bool IsUDPPacket(Ptr<Packet> p);
 
+// QuicPacket is a non-owning view of a PPP / IPv4 or IPv6 / UDP frame.
+// It copies the headers and the first bytes of the UDP payload out of the
+// packet, parses the header offsets once, and lets error models change
+// addresses, ports and payload bytes in place. Commit() writes the modified
+// bytes back to the front of the original packet, leaving the rest of the
+// payload untouched.
+//
+// A QuicPacket can also be a view of an Ethernet frame in memory, e.g. one
+// that an I/O thread just received. ns-3 packets must only be touched by the
+// simulator thread, frames can be processed on any thread.
 class QuicPacket {
 public:
+    // Number of leading UDP payload bytes that can be modified in place.
+    static const uint32_t kMaxPayloadPrefix = 64;
+
     QuicPacket(Ptr<Packet> p);
-    // Assemble a new packet.
-    // It uses the PPP, IP and UDP header that it parsed from the original packet,
-    // and recalculates IP and UDP checksums.
-    void ReassemblePacket();
-    Ipv4Header& GetIpv4Header();
-    UdpHeader& GetUdpHeader();
+    // A view of the Ethernet frame of len bytes at frame. Commit() writes
+    // modifications back to frame.
+    QuicPacket(uint8_t *frame, uint32_t len);
+
+    // Returns false if the packet is not a well-formed UDP packet.
+    bool IsValid() const;
+
+    bool IsIpv6() const;
+    // Addresses are Ipv4Address or Ipv6Address, depending on IsIpv6().
+    Address GetSource() const;
+    Address GetDestination() const;
+    uint16_t GetSourcePort() const;
+    uint16_t GetDestinationPort() const;
+    void SetSource(const Address &addr);
+    void SetDestination(const Address &addr);
+    void SetSourcePort(uint16_t port);
+    void SetDestinationPort(uint16_t port);
+
+    uint32_t GetUdpPayloadSize() const;
+    // Number of payload bytes accessible through Get/SetPayloadByte.
+    uint32_t GetUdpPayloadPrefixSize() const;
+    uint8_t GetPayloadByte(uint32_t pos) const;
+    void SetPayloadByte(uint32_t pos, uint8_t val);
+    bool IsVersionNegotiationPacket() const;
+
+    // Print "src:port -> dst:port", with IPv6 addresses in brackets.
+    void PrintFlow(std::ostream &os) const;
+    static void PrintAddress(std::ostream &os, const Address &addr);
+
+    // Write modified header and payload bytes back into the packet.
+    // The setters keep the IP and UDP checksums up to date incrementally
+    // (RFC 1624), so this never touches the rest of the payload, unless
+    // QuicPacketFullChecksum is set. Does nothing if nothing was modified.
+    void Commit();
+
+    // Fallback for modifications beyond the in-place prefix (not for
+    // frames):
+    // GetUdpPayload() copies the whole UDP payload out of the packet, and
+    // ReassemblePacket() rebuilds the packet from the (modified) headers and
+    // that copy, recalculating IP and UDP checksums.
     vector<uint8_t>& GetUdpPayload();
-    bool IsVersionNegotiationPacket();
+    void ReassemblePacket();
 
 private:
+    // PPP + IPv4 (with options) + UDP. An IPv6 header is shorter.
+    static const uint32_t kMaxHeaderLen = 2 + 60 + 8;
+
+    Address GetAddress(uint32_t offset) const;
+    void SetAddress(uint32_t offset, const Address &addr);
+
+    void MarkDirty(uint32_t end);
+    // Overwrite len bytes at offset, updating the checksums that cover them.
+    void Rewrite(uint32_t offset, const uint8_t *data, uint32_t len);
+    uint16_t ComputeUdpChecksum(const uint8_t *payload, uint32_t payload_len) const;
+    void UpdateIpv4Checksum();
+
+    // Copy the first len bytes of the packet or frame to dst.
+    uint32_t CopyData(uint8_t *dst, uint32_t len) const;
+
     Ptr<Packet> p_;
-    PppHeader ppp_hdr_;
-    Ipv4Header ipv4_hdr_;
-    UdpHeader udp_hdr_;
-    uint32_t udp_hdr_len_;
-    uint32_t total_hdr_len_;
+    uint8_t *frame_;
+    uint32_t frame_len_;
+    uint8_t buf_[kMaxHeaderLen + kMaxPayloadPrefix];
+    uint32_t buf_len_;
+    uint32_t ip_offset_;
+    uint32_t addr_offset_; // source address, followed by the destination
+    uint32_t addr_len_;
+    uint32_t udp_offset_;
+    uint32_t payload_offset_;
+    uint32_t payload_len_;
+    uint32_t dirty_end_;
+    bool ipv6_;
+    bool full_checksum_;
+    bool valid_;
     vector<uint8_t> udp_payload_;
 };
 
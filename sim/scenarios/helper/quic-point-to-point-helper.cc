@@ -2,11 +2,114 @@
 #include "ns3/traffic-control-helper.h"
 #include "ns3/ipv4-address-helper.h"
 #include "ns3/ipv6-address-helper.h"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/queue-disc.h"
 #include "quic-point-to-point-helper.h"
+#include "control-socket.h"
+#include "counters.h"
+#include "packet-capture.h"
 
 using namespace ns3;
 
-QuicPointToPointHelper::QuicPointToPointHelper() : queue_size_(StringValue("100p")) {
+static void CountForwarded(DirectionCounters *c, Ptr<const Packet> p) {
+  c->forwarded_packets.Add();
+  c->forwarded_bytes.Add(p->GetSize());
+}
+
+static void CountDropped(DirectionCounters *c, Ptr<const Packet> p) {
+  c->dropped_packets.Add();
+  c->dropped_bytes.Add(p->GetSize());
+}
+
+static void CountQueued(DirectionCounters *c, Ptr<const QueueDiscItem> item) {
+  c->queued_packets.Add();
+  c->queued_bytes.Add(item->GetSize());
+}
+
+static void CountQueueDropped(DirectionCounters *c, Ptr<const QueueDiscItem> item) {
+  c->queue_dropped_packets.Add();
+}
+
+static void CountDeviceQueueDropped(DirectionCounters *c, Ptr<const Packet> p) {
+  c->device_queue_dropped_packets.Add();
+}
+
+static void SetBacklogPackets(DirectionCounters *c, uint32_t old_value, uint32_t new_value) {
+  c->backlog_packets.Set(new_value);
+}
+
+static void SetBacklogBytes(DirectionCounters *c, uint32_t old_value, uint32_t new_value) {
+  c->backlog_bytes.Set(new_value);
+}
+
+static void RecordSojournTime(DirectionCounters *c, Time sojourn) {
+  c->sojourn_time.Record(sojourn.GetMicroSeconds());
+}
+
+// Scenarios change the data rate of the devices directly, and there is no
+// trace source for it. Sample it instead.
+static void SampleLinkRate(DirectionCounters *c, Ptr<NetDevice> device) {
+  DataRateValue rate;
+  device->GetAttribute("DataRate", rate);
+  c->link_rate.Set(rate.Get().GetBitRate());
+  Simulator::Schedule(MilliSeconds(100), &SampleLinkRate, c, device);
+}
+
+// Export the counters of one direction: packets arriving at rx_device
+// (after its receive error model) and the queue of the device sending them.
+static void ConnectCounters(const std::string &direction, Ptr<NetDevice> rx_device,
+                            Ptr<NetDevice> tx_device, Ptr<QueueDisc> queue) {
+  DirectionCounters *c = &CounterRegistry::Get().GetDirection(direction);
+  rx_device->TraceConnectWithoutContext("MacRx", MakeBoundCallback(&CountForwarded, c));
+  rx_device->TraceConnectWithoutContext("PhyRxDrop", MakeBoundCallback(&CountDropped, c));
+  queue->TraceConnectWithoutContext("Enqueue", MakeBoundCallback(&CountQueued, c));
+  queue->TraceConnectWithoutContext("Drop", MakeBoundCallback(&CountQueueDropped, c));
+  // The queue disc should keep the device's queue from overflowing.
+  tx_device->TraceConnectWithoutContext("MacTxDrop", MakeBoundCallback(&CountDeviceQueueDropped, c));
+  queue->TraceConnectWithoutContext("PacketsInQueue", MakeBoundCallback(&SetBacklogPackets, c));
+  queue->TraceConnectWithoutContext("BytesInQueue", MakeBoundCallback(&SetBacklogBytes, c));
+  queue->TraceConnectWithoutContext("SojournTime", MakeBoundCallback(&RecordSojournTime, c));
+  SampleLinkRate(c, tx_device);
+}
+
+static void CaptureForwarded(uint32_t interface, Ptr<const Packet> p) {
+  PacketCapture::Get().Capture(interface, p, PacketCapture::kForwarded);
+}
+
+static void CaptureDroppedByModel(uint32_t interface, Ptr<const Packet> p) {
+  PacketCapture::Get().Capture(interface, p, PacketCapture::kDroppedByModel);
+}
+
+static void CaptureDroppedByQueue(uint32_t interface, Ptr<const QueueDiscItem> item) {
+  PacketCapture::Get().CaptureDropped(interface, item);
+}
+
+// Capture the packets of one direction with their verdicts: at rx_device
+// after its receive error model, and when dropped by the queue.
+static void ConnectCapture(const std::string &direction, Ptr<NetDevice> rx_device, Ptr<QueueDisc> queue) {
+  PacketCapture &capture = PacketCapture::Get();
+  if (!capture.IsEnabled()) return;
+  const uint32_t interface = capture.AddInterface(direction, 9 /* LINKTYPE_PPP */);
+  rx_device->TraceConnectWithoutContext("MacRx", MakeBoundCallback(&CaptureForwarded, interface));
+  rx_device->TraceConnectWithoutContext("PhyRxDrop", MakeBoundCallback(&CaptureDroppedByModel, interface));
+  queue->TraceConnectWithoutContext("Drop", MakeBoundCallback(&CaptureDroppedByQueue, interface));
+}
+
+// Make the link, queue and error model of one direction reachable through
+// the control socket, as <direction>.* and, together with the other
+// direction, without the prefix.
+static void ConnectControl(const std::string &direction, Ptr<NetDevice> rx_device,
+                           Ptr<NetDevice> tx_device, Ptr<QueueDisc> queue) {
+  ControlSocket &control = ControlSocket::Get();
+  for (const std::string &prefix : {direction + ".", std::string()}) {
+    control.AddObject(prefix + "link", tx_device);
+    control.AddObject(prefix + "queue", queue);
+    control.AddPointer(prefix + "error_model", rx_device, "ReceiveErrorModel");
+  }
+}
+
+QuicPointToPointHelper::QuicPointToPointHelper()
+    : queue_size_(StringValue("100p")), queue_disc_("ns3::PfifoFastQueueDisc") {
   SetQueue("ns3::DropTailQueue", "MaxSize", StringValue("1p"));
 }
 
@@ -14,11 +117,24 @@ void QuicPointToPointHelper::SetQueueSize(StringValue size) {
   queue_size_ = size;
 }
 
+void QuicPointToPointHelper::SetQueueDisc(const std::string &type) {
+  queue_disc_ = type;
+}
+
 NetDeviceContainer QuicPointToPointHelper::Install(Ptr<Node> a, Ptr<Node> b) {
   NetDeviceContainer devices = PointToPointHelper::Install(a, b);
   TrafficControlHelper tch;
-  tch.SetRootQueueDisc("ns3::PfifoFastQueueDisc", "MaxSize", queue_size_);
-  tch.Install(devices);
+  tch.SetRootQueueDisc(queue_disc_, "MaxSize", queue_size_);
+  QueueDiscContainer queues = tch.Install(devices);
+
+  // The left node is on the client side.
+  ConnectCounters("to_client", devices.Get(0), devices.Get(1), queues.Get(1));
+  ConnectCounters("to_server", devices.Get(1), devices.Get(0), queues.Get(0));
+  ConnectCapture("to_client", devices.Get(0), queues.Get(1));
+  ConnectCapture("to_server", devices.Get(1), queues.Get(0));
+  ConnectControl("to_client", devices.Get(0), devices.Get(1), queues.Get(1));
+  ConnectControl("to_server", devices.Get(1), devices.Get(0), queues.Get(0));
+  ControlSocket::Get().AddObject("channel", devices.Get(0)->GetChannel());
 
   Ipv4AddressHelper ipv4;
   ipv4.SetBase("193.167.50.0", "255.255.255.0");
@@ -8,16 +8,21 @@ using namespace ns3;
 // The QuicPointToPointHelper acts like the ns3::PointToPointHelper,
 // but sets a ns3::DropTailQueue to one packet in order to minimize queueing latency.
 // Queues are simulated using a PfifoFastQueueDisc, with a default size of 100 packets.
-// The queue size can be set to a custom value using SetQueueSize().
+// The queue size can be set to a custom value using SetQueueSize(), and the
+// queue disc replaced using SetQueueDisc().
 class QuicPointToPointHelper : public PointToPointHelper {
 public:
   QuicPointToPointHelper();
 
-  // SetQueueSize sets the queue size for the PfifoFastQueueDisc
+  // SetQueueSize sets the queue size for the queue disc
   void SetQueueSize(StringValue);
+  // SetQueueDisc sets the type of the queue disc, e.g. ns3::FqCoDelQueueDisc.
+  // It needs to have a MaxSize attribute.
+  void SetQueueDisc(const std::string &type);
   NetDeviceContainer Install(Ptr<Node> a, Ptr<Node> b);
 private:
-  StringValue queue_size_; // for the PfifoFastQueueDisc
+  StringValue queue_size_; // for the queue disc
+  std::string queue_disc_;
 };
 
 #endif /* QUIC_POINT_TO_POINT_HELPER_H */
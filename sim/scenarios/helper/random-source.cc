@@ -0,0 +1,69 @@
+#include <iostream>
+#include <random>
+
+#include "random-source.h"
+
+#include "ns3/global-value.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/uinteger.h"
+
+using namespace ns3;
+using namespace std;
+
+static GlobalValue g_runSeed = GlobalValue("RunSeed",
+    "The seed of all random numbers of the run, 0 to pick a random seed",
+    UintegerValue(0), MakeUintegerChecker<uint64_t>());
+
+RandomSource &RandomSource::Get() {
+    static RandomSource source;
+    return source;
+}
+
+uint64_t RandomSource::GetSeed() {
+    call_once(seeded_, [this] {
+        UintegerValue seed;
+        g_runSeed.GetValue(seed);
+        seed_ = seed.Get();
+        if (seed_ == 0) {
+            random_device rd;
+            seed_ = uint64_t(rd()) << 32 | rd();
+        }
+    });
+    return seed_;
+}
+
+void RandomSource::Start() {
+    const uint64_t seed = GetSeed();
+    cout << "Run seed " << seed << " (replay with --RunSeed=" << seed << ")" << endl;
+    // ns-3 seeds must be between 1 and 2^32 - 209 (see RngStream).
+    RngSeedManager::SetSeed(uint32_t(DeriveKey("ns3", 0) % 4294944442ULL) + 1);
+}
+
+uint32_t RandomSource::Register(const string &name) {
+    lock_guard<mutex> lock(mutex_);
+    return streams_[name]++;
+}
+
+uint64_t RandomSource::DeriveKey(const string &name, uint32_t index) {
+    // FNV-1a of the name.
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : name) h = (h ^ c) * 0x100000001b3ULL;
+    return Mix(GetSeed() ^ Mix(h + index));
+}
+
+RandomStream::RandomStream(const string &name)
+    : name_(name), index_(RandomSource::Get().Register(name)), seeded_(false), key_(0), counter_(0),
+      next_(kBatch) {}
+
+void RandomStream::Refill() {
+    // The seed is only read here, so streams can be created before the
+    // command line is parsed.
+    if (!seeded_) {
+        key_ = RandomSource::Get().DeriveKey(name_, index_);
+        seeded_ = true;
+    }
+    const uint64_t base = key_ + counter_ * kGamma;
+    for (uint32_t i = 0; i < kBatch; i++) batch_[i] = RandomSource::Mix(base + (i + 1) * kGamma);
+    counter_ += kBatch;
+    next_ = 0;
+}
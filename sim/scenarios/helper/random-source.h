@@ -0,0 +1,86 @@
+#ifndef RANDOM_SOURCE_H
+#define RANDOM_SOURCE_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+// RandomSource derives all random numbers of a run from one seed: RunSeed,
+// or a random seed if RunSeed is 0 (the default). The seed is printed when
+// the simulation starts, so that a run can be replayed with
+// --RunSeed=<seed>.
+//
+// Every user of random numbers gets its own RandomStream, named after what
+// it is used for (e.g. "to_client.drop"). The seed of a stream only depends
+// on the run seed, its name, and how many streams of the same name were
+// created before it, not on when or how often other streams are used.
+class RandomSource {
+public:
+    static RandomSource &Get();
+
+    // Print the seed, and seed the random variables of ns-3 (e.g. the
+    // jitter models) from it. Call before creating any ns-3 random variable.
+    void Start();
+
+    // The run seed. Fixed on first use.
+    uint64_t GetSeed();
+    // Returns how many streams of this name were registered before.
+    uint32_t Register(const std::string &name);
+    // The key of the index'th stream of this name.
+    uint64_t DeriveKey(const std::string &name, uint32_t index);
+
+    // The SplitMix64 finalizer.
+    static uint64_t Mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+private:
+    RandomSource() : seed_(0) {}
+    RandomSource(const RandomSource &) = delete;
+    RandomSource &operator=(const RandomSource &) = delete;
+
+    std::once_flag seeded_;
+    uint64_t seed_;
+    std::mutex mutex_;
+    std::map<std::string, uint32_t> streams_;
+};
+
+// A RandomStream generates uniformly distributed 64 bit numbers. They are
+// generated kBatch at a time, as SplitMix64 of consecutive counters: the
+// numbers of a batch don't depend on each other, so the compiler vectorizes
+// the loop, and drawing a number just reads the next one from the batch.
+// A stream is not thread-safe. It is seeded on first use.
+class RandomStream {
+public:
+    explicit RandomStream(const std::string &name);
+
+    uint64_t Next() {
+        if (next_ == kBatch) Refill();
+        return batch_[next_++];
+    }
+    // A number in [0, n).
+    uint32_t Below(uint32_t n) { return ((Next() >> 32) * n) >> 32; }
+    // A number in [lo, hi].
+    uint32_t Between(uint32_t lo, uint32_t hi) { return lo + (uint32_t)(((Next() >> 32) * (uint64_t(hi - lo) + 1)) >> 32); }
+    // A number in (0, 1].
+    double Uniform() { return ((Next() >> 11) + 1) * 0x1.0p-53; }
+
+private:
+    static const uint32_t kBatch = 256;
+    static const uint64_t kGamma = 0x9e3779b97f4a7c15ULL;
+
+    void Refill();
+
+    std::string name_;
+    uint32_t index_;
+    bool seeded_;
+    uint64_t key_;
+    uint64_t counter_;
+    uint32_t next_;
+    uint64_t batch_[kBatch];
+};
+
+#endif /* RANDOM_SOURCE_H */
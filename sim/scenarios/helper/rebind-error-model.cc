@@ -0,0 +1,62 @@
+#include "rebind-error-model.h"
+#include "ns3/core-module.h"
+
+using namespace std;
+
+NS_OBJECT_ENSURE_REGISTERED(RebindErrorModel);
+
+TypeId RebindErrorModel::GetTypeId(void) {
+  static TypeId tid = TypeId("RebindErrorModel")
+                          .SetParent<ErrorModel>()
+                          .AddConstructor<RebindErrorModel>();
+  return tid;
+}
+
+RebindErrorModel::RebindErrorModel()
+    : nat("RebindErrorModel"), rebind_addr(false) {}
+
+void RebindErrorModel::DoReset() {}
+
+void RebindErrorModel::SetRebindAddr(bool ra) { rebind_addr = ra; }
+
+void RebindErrorModel::SetMode(NatTable::Mode mode) { nat.SetMode(mode); }
+
+void RebindErrorModel::SetPortPreservation(bool preserve) {
+  nat.SetPortPreservation(preserve);
+}
+
+void RebindErrorModel::SetIdleTimeout(Time timeout) {
+  nat.SetIdleTimeout(timeout);
+}
+
+void RebindErrorModel::SetCounters(const DirectionCounters &to_client,
+                                   const DirectionCounters &to_server) {
+  to_client_counters = to_client;
+  to_server_counters = to_server;
+}
+
+void RebindErrorModel::DoRebind() { nat.Rebind(rebind_addr); }
+
+bool RebindErrorModel::DoCorrupt(Ptr<Packet> p) {
+  if(!IsUDPPacket(p)) return false;
+
+  QuicPacket qp = QuicPacket(p);
+  if (!qp.IsValid()) return false;
+
+  switch (nat.Translate(qp)) {
+  case NatTable::kUnchanged:
+    return false;
+  case NatTable::kTranslatedSource:
+    to_server_counters.rebound_packets.Add();
+    to_server_counters.rebound_bytes.Add(qp.GetUdpPayloadSize());
+    break;
+  case NatTable::kTranslatedDestination:
+    to_client_counters.rebound_packets.Add();
+    to_client_counters.rebound_bytes.Add(qp.GetUdpPayloadSize());
+    break;
+  case NatTable::kDrop:
+    return true;
+  }
+  qp.Commit();
+  return false;
+}
@@ -0,0 +1,37 @@
+#ifndef REBIND_ERROR_MODEL_H
+#define REBIND_ERROR_MODEL_H
+
+#include "counters.h"
+#include "nat-table.h"
+#include "ns3/error-model.h"
+#include "ns3/nstime.h"
+
+using namespace ns3;
+
+// The RebindErrorModel is a NAT in front of the clients, that assigns new
+// ports (and optionally, new addresses) to all bindings on DoRebind(). The
+// same model has to be installed in both directions. Without DoRebind(), it
+// is a plain NAT, see the nat scenario. See NatTable.
+class RebindErrorModel : public ErrorModel {
+public:
+  static TypeId GetTypeId(void);
+  RebindErrorModel();
+  void DoRebind();
+  void SetRebindAddr(bool ra);
+  // The NAT's mapping and filtering, and port preservation. See NatTable.
+  void SetMode(NatTable::Mode mode);
+  void SetPortPreservation(bool preserve);
+  // Expire bindings that carried no packets for timeout (zero: never).
+  void SetIdleTimeout(Time timeout);
+  void SetCounters(const DirectionCounters &to_client,
+                   const DirectionCounters &to_server);
+
+private:
+  bool DoCorrupt(Ptr<Packet> p);
+  void DoReset(void);
+  NatTable nat;
+  bool rebind_addr;
+  DirectionCounters to_client_counters, to_server_counters;
+};
+
+#endif /* REBIND_ERROR_MODEL_H */
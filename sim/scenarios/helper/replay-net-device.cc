@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <iostream>
+
+#include "replay-net-device.h"
+
+#include "ns3/abort.h"
+#include "ns3/ethernet-header.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+
+using namespace ns3;
+using namespace std;
+
+// Link type of Ethernet captures.
+static const uint32_t kDltEthernet = 1;
+static const uint32_t kSnapLen = 65535;
+
+NS_OBJECT_ENSURE_REGISTERED(ReplayNetDevice);
+
+TypeId ReplayNetDevice::GetTypeId(void) {
+    static TypeId tid = TypeId("ReplayNetDevice")
+        .SetParent<NetDevice>()
+        .AddConstructor<ReplayNetDevice>()
+        .AddAttribute("Address",
+                      "The MAC address of this device",
+                      Mac48AddressValue(Mac48Address("ff:ff:ff:ff:ff:ff")),
+                      MakeMac48AddressAccessor(&ReplayNetDevice::address_),
+                      MakeMac48AddressChecker());
+    return tid;
+}
+
+ReplayNetDevice::ReplayNetDevice()
+    : ifindex_(0), mtu_(1500), peer_(Mac48Address::GetBroadcast()), peer_known_(false),
+      has_input_(false), has_next_(false), next_(kSnapLen), next_len_(0), replayed_(0),
+      sent_(0), skipped_(0) {}
+
+void ReplayNetDevice::Open(const string &input, const string &output,
+                           const Ipv4InterfaceAddress &ipv4, const Ipv6InterfaceAddress &ipv6) {
+    input_name_ = input;
+    output_name_ = output;
+    ipv4_ = ipv4;
+    ipv6_ = ipv6;
+
+    output_.Open(output, ios::out | ios::binary);
+    NS_ABORT_MSG_IF(output_.Fail(), "Can't create " << output);
+    output_.Init(kDltEthernet, kSnapLen);
+
+    if (input.empty()) return;
+    input_.Open(input, ios::in | ios::binary);
+    NS_ABORT_MSG_IF(input_.Fail(), "Can't read " << input);
+    NS_ABORT_MSG_IF(input_.GetDataLinkType() != kDltEthernet, input << " is not an Ethernet capture");
+    has_input_ = true;
+    has_next_ = ReadNext();
+}
+
+bool ReplayNetDevice::ReadNext() {
+    while (true) {
+        uint32_t ts_sec, ts_frac, incl_len, orig_len, read_len;
+        input_.Read(next_.data(), next_.size(), ts_sec, ts_frac, incl_len, orig_len, read_len);
+        if (input_.Fail() || input_.Eof()) return false;
+        // Truncated frames can't be replayed.
+        if (incl_len < orig_len || read_len < orig_len) {
+            skipped_++;
+            continue;
+        }
+        if (!FromEndpoint(next_.data(), read_len)) continue;
+        next_len_ = read_len;
+        next_ts_ = Seconds(ts_sec) + (input_.IsNanoSecMode() ? NanoSeconds(ts_frac) : MicroSeconds(ts_frac));
+        return true;
+    }
+}
+
+bool ReplayNetDevice::FromEndpoint(const uint8_t *frame, uint32_t len) const {
+    if (len < 14) return false;
+    const uint16_t type = frame[12] << 8 | frame[13];
+    const uint8_t *ip = frame + 14;
+    if (type == 0x0800 && len >= 14 + 20) {
+        const Ipv4Address source = Ipv4Address::Deserialize(ip + 12);
+        return source != ipv4_.GetLocal() && ipv4_.GetMask().IsMatch(source, ipv4_.GetLocal());
+    }
+    if (type == 0x86dd && len >= 14 + 40) {
+        const Ipv6Address source = Ipv6Address::Deserialize(ip + 8);
+        return source != ipv6_.GetAddress() && ipv6_.GetPrefix().IsMatch(source, ipv6_.GetAddress());
+    }
+    // ARP, neighbor discovery from link-local addresses, ...
+    return false;
+}
+
+Time ReplayNetDevice::GetFirstTimestamp() const {
+    return has_next_ ? next_ts_ : Time::Max();
+}
+
+void ReplayNetDevice::Start(Time origin, Callback<void> done) {
+    origin_ = origin;
+    done_ = done;
+    if (!has_next_) {
+        done_();
+        return;
+    }
+    Simulator::ScheduleWithContext(node_->GetId(), next_ts_ - origin_, &ReplayNetDevice::Replay, this);
+}
+
+void ReplayNetDevice::Replay() {
+    WriteFrame(next_.data(), next_len_);
+    replayed_++;
+    ForwardUp(next_.data(), next_len_);
+    has_next_ = ReadNext();
+    if (!has_next_) {
+        done_();
+        return;
+    }
+    // Frames are (nearly always) recorded in order. Replay the ones that
+    // aren't right away.
+    const Time delay = max(next_ts_ - origin_ - Simulator::Now(), Seconds(0));
+    Simulator::Schedule(delay, &ReplayNetDevice::Replay, this);
+}
+
+void ReplayNetDevice::ForwardUp(const uint8_t *frame, uint32_t len) {
+    Ptr<Packet> packet = Create<Packet>(frame, len);
+    EthernetHeader header(false);
+    packet->RemoveHeader(header);
+    peer_ = header.GetSource();
+    peer_known_ = true;
+    const uint16_t protocol = header.GetLengthType();
+    // The frame was addressed to the interface in the recording.
+    if (!promisc_rx_callback_.IsNull())
+        promisc_rx_callback_(this, packet, protocol, header.GetSource(), address_, NS3_PACKET_HOST);
+    if (!rx_callback_.IsNull()) rx_callback_(this, packet, protocol, header.GetSource());
+}
+
+void ReplayNetDevice::WriteFrame(const uint8_t *frame, uint32_t len) {
+    const Time t = origin_ + Simulator::Now();
+    const int64_t us = t.GetMicroSeconds();
+    output_.Write(us / 1000000, us % 1000000, frame, len);
+}
+
+bool ReplayNetDevice::Send(Ptr<Packet> packet, const Address &dest, uint16_t protocolNumber) {
+    return SendFrom(packet, address_, dest, protocolNumber);
+}
+
+bool ReplayNetDevice::SendFrom(Ptr<Packet> packet, const Address &source, const Address &dest,
+                               uint16_t protocolNumber) {
+    EthernetHeader header(false);
+    header.SetSource(Mac48Address::ConvertFrom(source));
+    // Without ARP, the stack sends everything to the broadcast address.
+    const Mac48Address destination = Mac48Address::ConvertFrom(dest);
+    header.SetDestination(destination.IsBroadcast() && peer_known_ ? peer_ : destination);
+    header.SetLengthType(protocolNumber);
+    Ptr<Packet> frame = packet->Copy();
+    frame->AddHeader(header);
+
+    vector<uint8_t> buf(frame->GetSize());
+    frame->CopyData(buf.data(), buf.size());
+    WriteFrame(buf.data(), buf.size());
+    sent_++;
+    return true;
+}
+
+void ReplayNetDevice::DoDispose(void) {
+    if (has_input_) {
+        cout << input_name_ << ": replayed " << replayed_ << " frames";
+        if (skipped_ > 0) cout << " (skipped " << skipped_ << " truncated frames)";
+        cout << endl;
+        input_.Close();
+    }
+    cout << output_name_ << ": wrote " << replayed_ + sent_ << " frames (" << sent_
+         << " after impairments)" << endl;
+    output_.Close();
+    node_ = nullptr;
+    rx_callback_.Nullify();
+    promisc_rx_callback_.Nullify();
+    done_.Nullify();
+    NetDevice::DoDispose();
+}
+
+void ReplayNetDevice::SetIfIndex(const uint32_t index) { ifindex_ = index; }
+
+uint32_t ReplayNetDevice::GetIfIndex(void) const { return ifindex_; }
+
+Ptr<Channel> ReplayNetDevice::GetChannel(void) const { return nullptr; }
+
+void ReplayNetDevice::SetAddress(Address address) { address_ = Mac48Address::ConvertFrom(address); }
+
+Address ReplayNetDevice::GetAddress(void) const { return address_; }
+
+bool ReplayNetDevice::SetMtu(const uint16_t mtu) {
+    mtu_ = mtu;
+    return true;
+}
+
+uint16_t ReplayNetDevice::GetMtu(void) const { return mtu_; }
+
+bool ReplayNetDevice::IsLinkUp(void) const { return true; }
+
+void ReplayNetDevice::AddLinkChangeCallback(Callback<void> callback) {}
+
+bool ReplayNetDevice::IsBroadcast(void) const { return true; }
+
+Address ReplayNetDevice::GetBroadcast(void) const { return Mac48Address::GetBroadcast(); }
+
+bool ReplayNetDevice::IsMulticast(void) const { return true; }
+
+Address ReplayNetDevice::GetMulticast(Ipv4Address multicastGroup) const {
+    return Mac48Address::GetMulticast(multicastGroup);
+}
+
+Address ReplayNetDevice::GetMulticast(Ipv6Address addr) const { return Mac48Address::GetMulticast(addr); }
+
+bool ReplayNetDevice::IsBridge(void) const { return false; }
+
+bool ReplayNetDevice::IsPointToPoint(void) const { return false; }
+
+Ptr<Node> ReplayNetDevice::GetNode(void) const { return node_; }
+
+void ReplayNetDevice::SetNode(Ptr<Node> node) { node_ = node; }
+
+bool ReplayNetDevice::NeedsArp(void) const { return false; }
+
+void ReplayNetDevice::SetReceiveCallback(NetDevice::ReceiveCallback cb) { rx_callback_ = cb; }
+
+void ReplayNetDevice::SetPromiscReceiveCallback(NetDevice::PromiscReceiveCallback cb) {
+    promisc_rx_callback_ = cb;
+}
+
+bool ReplayNetDevice::SupportsSendFrom(void) const { return true; }
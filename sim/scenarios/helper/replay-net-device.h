@@ -0,0 +1,111 @@
+#ifndef REPLAY_NET_DEVICE_H
+#define REPLAY_NET_DEVICE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ns3/internet-module.h"
+#include "ns3/mac48-address.h"
+#include "ns3/net-device.h"
+#include "ns3/network-module.h"
+#include "ns3/node.h"
+
+using namespace ns3;
+
+// ReplayNetDevice stands in for eth0 / eth1 when the simulator replays a
+// recorded trace instead of running in real time (see --ReplayLeft and
+// --ReplayRight). It reads a pcap file that was captured on the interface
+// (like the trace_node_left.pcap / trace_node_right.pcap that run.sh
+// writes), and hands the frames that the endpoint sent to the node, at the
+// time they were recorded. Frames that the simulator sent in the recording
+// are skipped: they are regenerated by the simulation.
+//
+// All frames, the replayed ones and the ones the node sends to the endpoint
+// (after the link applied its impairments), are written to an output pcap
+// file, using the timestamps of the recording.
+//
+// The endpoint doesn't answer ARP or neighbor solicitations, so the device
+// doesn't need them. Frames to the endpoint are addressed to the MAC
+// address it used in the recording.
+class ReplayNetDevice : public NetDevice {
+public:
+    static TypeId GetTypeId(void);
+    ReplayNetDevice();
+
+    // Read the frames to replay from input (empty: replay nothing), and
+    // write all frames to output. The endpoint's frames are those from an
+    // address on the interface's subnets, other than the interface's own.
+    // Aborts if a file can't be opened.
+    void Open(const std::string &input, const std::string &output,
+              const Ipv4InterfaceAddress &ipv4, const Ipv6InterfaceAddress &ipv6);
+    // The timestamp of the first frame to replay. Time::Max() if there is
+    // none.
+    Time GetFirstTimestamp() const;
+    // Start replaying. A frame recorded at t is received at simulation time
+    // t - origin. done is called after the last frame.
+    void Start(Time origin, Callback<void> done);
+
+    void SetIfIndex(const uint32_t index) override;
+    uint32_t GetIfIndex(void) const override;
+    Ptr<Channel> GetChannel(void) const override;
+    void SetAddress(Address address) override;
+    Address GetAddress(void) const override;
+    bool SetMtu(const uint16_t mtu) override;
+    uint16_t GetMtu(void) const override;
+    bool IsLinkUp(void) const override;
+    void AddLinkChangeCallback(Callback<void> callback) override;
+    bool IsBroadcast(void) const override;
+    Address GetBroadcast(void) const override;
+    bool IsMulticast(void) const override;
+    Address GetMulticast(Ipv4Address multicastGroup) const override;
+    Address GetMulticast(Ipv6Address addr) const override;
+    bool IsBridge(void) const override;
+    bool IsPointToPoint(void) const override;
+    bool Send(Ptr<Packet> packet, const Address &dest, uint16_t protocolNumber) override;
+    bool SendFrom(Ptr<Packet> packet, const Address &source, const Address &dest,
+                  uint16_t protocolNumber) override;
+    Ptr<Node> GetNode(void) const override;
+    void SetNode(Ptr<Node> node) override;
+    bool NeedsArp(void) const override;
+    void SetReceiveCallback(NetDevice::ReceiveCallback cb) override;
+    void SetPromiscReceiveCallback(NetDevice::PromiscReceiveCallback cb) override;
+    bool SupportsSendFrom(void) const override;
+
+protected:
+    void DoDispose(void) override;
+
+private:
+    // Read the next frame that the endpoint sent into next_. Returns false
+    // at the end of the input.
+    bool ReadNext();
+    bool FromEndpoint(const uint8_t *frame, uint32_t len) const;
+    void Replay();
+    void ForwardUp(const uint8_t *frame, uint32_t len);
+    void WriteFrame(const uint8_t *frame, uint32_t len);
+
+    std::string input_name_, output_name_;
+    Ptr<Node> node_;
+    uint32_t ifindex_;
+    Mac48Address address_;
+    uint16_t mtu_;
+    NetDevice::ReceiveCallback rx_callback_;
+    NetDevice::PromiscReceiveCallback promisc_rx_callback_;
+
+    Ipv4InterfaceAddress ipv4_;
+    Ipv6InterfaceAddress ipv6_;
+    Mac48Address peer_;
+    bool peer_known_;
+
+    PcapFile input_, output_;
+    bool has_input_, has_next_;
+    std::vector<uint8_t> next_;
+    uint32_t next_len_;
+    Time next_ts_; // as recorded
+    Time origin_;
+    Callback<void> done_;
+
+    uint64_t replayed_, sent_, skipped_;
+};
+
+#endif /* REPLAY_NET_DEVICE_H */
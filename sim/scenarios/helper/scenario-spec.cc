@@ -0,0 +1,106 @@
+#include <fstream>
+#include <sstream>
+
+#include "scenario-spec.h"
+#include "control-socket.h"
+#include "counters.h"
+#include "impairment-pipeline.h"
+#include "quic-point-to-point-helper.h"
+
+#include "ns3/abort.h"
+#include "ns3/pointer.h"
+#include "ns3/string.h"
+
+using namespace ns3;
+using namespace std;
+
+static string Trim(const string &s) {
+    const size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == string::npos) return "";
+    const size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+ScenarioSpec::ScenarioSpec()
+    : queue_("100p"), queue_disc_("ns3::PfifoFastQueueDisc"), duration_(Seconds(36000)) {}
+
+ScenarioSpec ScenarioSpec::Load(const string &filename) {
+    ifstream in(filename);
+    NS_ABORT_MSG_IF(!in, "Can't read " << filename);
+    ScenarioSpec spec;
+    spec.filename_ = filename;
+    string line;
+    for (int n = 1; getline(in, line); n++) {
+        const size_t comment = line.find('#');
+        if (comment != string::npos) line.erase(comment);
+        line = Trim(line);
+        if (line.empty()) continue;
+
+        if (line.compare(0, 3, "at ") == 0) {
+            // at <time> set ... is run as set ... at <time>.
+            istringstream args(line.substr(3));
+            string time, command;
+            args >> time >> command;
+            NS_ABORT_MSG_IF(command != "set", filename << ":" << n << ": expected at <time> set <object> <attribute> <value>");
+            string rest;
+            getline(args, rest);
+            spec.timeline_.push_back({n, "set " + Trim(rest) + " at " + time});
+            continue;
+        }
+
+        const size_t eq = line.find('=');
+        NS_ABORT_MSG_IF(eq == string::npos, filename << ":" << n << ": expected <setting> = <value>");
+        const string key = Trim(line.substr(0, eq));
+        const string value = Trim(line.substr(eq + 1));
+        if (key == "bandwidth") {
+            spec.bandwidth_ = value;
+        } else if (key == "delay") {
+            spec.delay_ = value;
+        } else if (key == "queue") {
+            // In packets, unless there is a unit.
+            spec.queue_ = value.find_first_not_of("0123456789") == string::npos ? value + "p" : value;
+        } else if (key == "queue_disc") {
+            spec.queue_disc_ = value;
+        } else if (key == "to_client") {
+            spec.to_client_ = value;
+        } else if (key == "to_server") {
+            spec.to_server_ = value;
+        } else if (key == "duration") {
+            spec.duration_ = Time(value);
+        } else {
+            NS_ABORT_MSG(filename << ":" << n << ": unknown setting " << key);
+        }
+    }
+    NS_ABORT_MSG_IF(spec.bandwidth_.empty(), filename << ": missing setting: bandwidth");
+    NS_ABORT_MSG_IF(spec.delay_.empty(), filename << ": missing setting: delay");
+    return spec;
+}
+
+NetDeviceContainer ScenarioSpec::Build(QuicNetworkSimulatorHelper &sim) const {
+    QuicPointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue(bandwidth_));
+    p2p.SetChannelAttribute("Delay", StringValue(delay_));
+    p2p.SetQueueSize(StringValue(queue_));
+    p2p.SetQueueDisc(queue_disc_);
+
+    NetDeviceContainer devices = p2p.Install(sim.GetLeftNode(), sim.GetRightNode());
+
+    // See the impairments scenario.
+    ImpairmentPipelineHelper impairments;
+    Ptr<ImpairmentPipeline> client_impairments = impairments.Create(to_client_, "to_client");
+    Ptr<ImpairmentPipeline> server_impairments = impairments.Create(to_server_, "to_server");
+    client_impairments->SetCounters(CounterRegistry::Get().GetDirection("to_client"));
+    server_impairments->SetCounters(CounterRegistry::Get().GetDirection("to_server"));
+    if (!sim.SetIngressImpairments(client_impairments, server_impairments)) {
+        if (!client_impairments->IsEmpty())
+            devices.Get(0)->SetAttribute("ReceiveErrorModel", PointerValue(client_impairments));
+        if (!server_impairments->IsEmpty())
+            devices.Get(1)->SetAttribute("ReceiveErrorModel", PointerValue(server_impairments));
+    }
+
+    for (const Event &event : timeline_) {
+        const string reply = ControlSocket::Get().Execute(event.command);
+        NS_ABORT_MSG_IF(reply.compare(0, 2, "ok") != 0, filename_ << ":" << event.line << ": " << reply);
+    }
+    return devices;
+}
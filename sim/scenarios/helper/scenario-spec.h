@@ -0,0 +1,59 @@
+#ifndef SCENARIO_SPEC_H
+#define SCENARIO_SPEC_H
+
+#include <string>
+#include <vector>
+
+#include "ns3/net-device-container.h"
+#include "ns3/nstime.h"
+#include "quic-network-simulator-helper.h"
+
+using namespace ns3;
+
+// A ScenarioSpec describes a scenario declaratively: the link, its queue
+// disc, the impairments of each direction and a timeline of changes. It is
+// read from a text file, one setting per line, e.g.
+//   # 10Mbps, 15ms, and random loss towards the client
+//   bandwidth = 10Mbps
+//   delay = 15ms
+//   queue = 25
+//   to_client = drop:rate=5,burst=3
+//   at 30s set link DataRate 5Mbps
+// The settings are:
+//   bandwidth:  the data rate of the link (required)
+//   delay:      the one-way delay of the link (required)
+//   queue:      the size of the queue disc, in packets, or with a unit
+//               (e.g. 30000B), 100 packets by default
+//   queue_disc: the type of the queue disc, ns3::PfifoFastQueueDisc by
+//               default
+//   to_client, to_server: the impairments of each direction, see
+//               ImpairmentPipelineHelper
+//   duration:   how long the simulation runs, 36000s by default
+// Timeline lines (at <time> set <object> <attribute> <value>) change the
+// link at the given simulated time, see ControlSocket.
+class ScenarioSpec {
+public:
+    // Read the spec from filename. Aborts on errors.
+    static ScenarioSpec Load(const std::string &filename);
+
+    // Build the link between the nodes of sim, install the impairments and
+    // schedule the timeline.
+    NetDeviceContainer Build(QuicNetworkSimulatorHelper &sim) const;
+    Time GetDuration() const { return duration_; }
+
+private:
+    ScenarioSpec();
+
+    struct Event {
+        int line;
+        std::string command;
+    };
+
+    std::string filename_;
+    std::string bandwidth_, delay_, queue_, queue_disc_;
+    std::string to_client_, to_server_;
+    Time duration_;
+    std::vector<Event> timeline_;
+};
+
+#endif /* SCENARIO_SPEC_H */
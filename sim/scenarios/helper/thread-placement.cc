@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <malloc.h>
+#include <pthread.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "thread-placement.h"
+
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/global-value.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+using namespace ns3;
+using namespace std;
+
+static GlobalValue g_simulatorCpu = GlobalValue("SimulatorCpu",
+    "Cores to pin the simulator thread to, e.g. 2 or 2-3 (empty: don't pin)",
+    StringValue(""), MakeStringChecker());
+
+static GlobalValue g_ioCpus = GlobalValue("IoCpus",
+    "Cores to pin the threads reading and writing eth0 / eth1 to, e.g. 4,5 (empty: don't pin)",
+    StringValue(""), MakeStringChecker());
+
+static GlobalValue g_helperCpus = GlobalValue("HelperCpus",
+    "Cores to pin helper threads (e.g. the event log writer) to (empty: don't pin)",
+    StringValue(""), MakeStringChecker());
+
+static GlobalValue g_realtimePriority = GlobalValue("RealtimePriority",
+    "Run the simulator and I/O threads under SCHED_FIFO with this priority (0: don't)",
+    UintegerValue(0), MakeUintegerChecker<uint32_t>(0, 99));
+
+static GlobalValue g_lockMemory = GlobalValue("LockMemory",
+    "Lock (and pre-fault) all memory of the simulator",
+    BooleanValue(false), MakeBooleanChecker());
+
+static const char *kRoleNames[] = {"simulator", "I/O", "helper"};
+
+// Parses a list of cores like "1,3-5".
+static cpu_set_t ParseCpuList(const GlobalValue &value) {
+    StringValue list;
+    value.GetValue(list);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    stringstream ss(list.Get());
+    string range;
+    while (getline(ss, range, ',')) {
+        if (range.empty()) continue;
+        const size_t dash = range.find('-');
+        int first, last;
+        try {
+            first = stoi(range.substr(0, dash));
+            last = dash == string::npos ? first : stoi(range.substr(dash + 1));
+        } catch (const exception &) {
+            NS_ABORT_MSG("invalid CPU list: " << list.Get());
+        }
+        NS_ABORT_MSG_IF(first < 0 || last < first || last >= CPU_SETSIZE, "invalid CPU list: " << list.Get());
+        for (int cpu = first; cpu <= last; cpu++) CPU_SET(cpu, &set);
+    }
+    return set;
+}
+
+static string FormatCpus(const cpu_set_t &set) {
+    string s;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &set)) continue;
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set)) last++;
+        if (!s.empty()) s += ",";
+        s += to_string(cpu);
+        if (last > cpu) s += "-" + to_string(last);
+        cpu = last;
+    }
+    return s;
+}
+
+static pid_t GetTid() {
+    return syscall(SYS_gettid);
+}
+
+ThreadPlacement &ThreadPlacement::Get() {
+    static ThreadPlacement placement;
+    return placement;
+}
+
+ThreadPlacement::ThreadPlacement() {
+    cpus_[kSimulator] = ParseCpuList(g_simulatorCpu);
+    cpus_[kIo] = ParseCpuList(g_ioCpus);
+    cpus_[kHelper] = ParseCpuList(g_helperCpus);
+    UintegerValue priority;
+    g_realtimePriority.GetValue(priority);
+    priority_ = priority.Get();
+    BooleanValue lock_memory;
+    g_lockMemory.GetValue(lock_memory);
+    lock_memory_ = lock_memory.Get();
+}
+
+void ThreadPlacement::Place(pid_t tid, Role role, const string &name, int cpu) {
+    cpu_set_t set = cpus_[role];
+    if (cpu >= 0) {
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+    }
+    if (CPU_COUNT(&set) > 0 && sched_setaffinity(tid, sizeof(set), &set) < 0)
+        cout << "Can't pin the " << name << " thread to CPUs " << FormatCpus(set) << ": "
+             << strerror(errno) << endl;
+    if (priority_ > 0 && role != kHelper) {
+        struct sched_param param;
+        param.sched_priority = priority_;
+        if (sched_setscheduler(tid, SCHED_FIFO, &param) < 0)
+            cout << "Can't run the " << name << " thread under SCHED_FIFO: " << strerror(errno) << endl;
+    }
+    lock_guard<mutex> lock(mutex_);
+    threads_.push_back({tid, name, role});
+}
+
+void ThreadPlacement::PlaceCurrentThread(Role role, const string &name, int cpu) {
+    // Thread names are limited to 15 characters.
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+    Place(GetTid(), role, name, cpu);
+}
+
+void ThreadPlacement::Setup() {
+    PlaceCurrentThread(kSimulator, "simulator");
+    if (!lock_memory_) return;
+
+    // Keep freed memory in the (locked) heap, rather than returning it to
+    // the kernel and faulting it in again.
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        cout << "Can't lock memory: " << strerror(errno) << endl;
+        return;
+    }
+    // Fault in the stack that the simulator thread is going to use.
+    volatile char stack[256 * 1024];
+    for (size_t i = 0; i < sizeof(stack); i += 4096) stack[i] = 0;
+}
+
+void ThreadPlacement::PlaceOtherThreadsAndReport() {
+    vector<pid_t> others;
+    DIR *dir = opendir("/proc/self/task");
+    if (dir) {
+        while (struct dirent *entry = readdir(dir)) {
+            if (entry->d_name[0] == '.') continue;
+            const pid_t tid = atoi(entry->d_name);
+            lock_guard<mutex> lock(mutex_);
+            if (none_of(threads_.begin(), threads_.end(), [tid](const Thread &t) { return t.tid == tid; }))
+                others.push_back(tid);
+        }
+        closedir(dir);
+    }
+    for (pid_t tid : others) Place(tid, kIo, "I/O " + to_string(tid), -1);
+
+    lock_guard<mutex> lock(mutex_);
+    for (const Thread &t : threads_) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        sched_getaffinity(t.tid, sizeof(set), &set);
+        const int policy = sched_getscheduler(t.tid);
+        struct sched_param param;
+        sched_getparam(t.tid, &param);
+        cout << "Placement: " << t.name << " (" << kRoleNames[t.role] << " thread, tid " << t.tid
+             << "): CPUs " << FormatCpus(set);
+        if (policy == SCHED_FIFO) cout << ", SCHED_FIFO " << param.sched_priority;
+        cout << endl;
+    }
+    if (lock_memory_) {
+        ifstream status("/proc/self/status");
+        string line;
+        while (getline(status, line))
+            if (line.rfind("VmLck:", 0) == 0) cout << "Placement: memory locked, " << line << endl;
+    }
+}
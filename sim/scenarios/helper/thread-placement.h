@@ -0,0 +1,62 @@
+#ifndef THREAD_PLACEMENT_H
+#define THREAD_PLACEMENT_H
+
+#include <mutex>
+#include <sched.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// ThreadPlacement keeps the threads of the simulator off each other's (and
+// the endpoints') cores, so that CPU contention doesn't show up as delay
+// that the scenario never configured. There are three kinds of threads:
+//  - the simulator thread, which runs the realtime event loop
+//    (SimulatorCpu),
+//  - I/O threads, which read and write frames on eth0 / eth1 (IoCpus),
+//  - helper threads, e.g. the event log writer (HelperCpus).
+// The simulator and the I/O threads can run under SCHED_FIFO
+// (RealtimePriority), and LockMemory locks (and thereby pre-faults) all
+// memory, so the simulation doesn't stall on page faults.
+//
+// All settings default to off. Failures (e.g. missing CAP_SYS_NICE) are
+// reported, but are not fatal: PlaceOtherThreadsAndReport() prints the
+// placement that each thread actually got.
+class ThreadPlacement {
+public:
+    enum Role { kSimulator, kIo, kHelper };
+
+    static ThreadPlacement &Get();
+
+    // Pin the calling thread according to its role, and name it. cpu >= 0
+    // overrides the cores configured for the role.
+    void PlaceCurrentThread(Role role, const std::string &name, int cpu = -1);
+
+    // Called before the simulation starts, on the simulator thread: place
+    // it, and lock memory.
+    void Setup();
+    // Place the threads that ns-3 started (the FdNetDevice readers) as I/O
+    // threads, and print the placement of all threads.
+    void PlaceOtherThreadsAndReport();
+
+private:
+    ThreadPlacement();
+    ThreadPlacement(const ThreadPlacement &) = delete;
+    ThreadPlacement &operator=(const ThreadPlacement &) = delete;
+
+    struct Thread {
+        pid_t tid;
+        std::string name;
+        Role role;
+    };
+
+    void Place(pid_t tid, Role role, const std::string &name, int cpu);
+
+    cpu_set_t cpus_[3]; // by Role, empty: don't pin
+    int priority_;      // SCHED_FIFO priority of the simulator and I/O threads, 0: off
+    bool lock_memory_;
+
+    std::mutex mutex_;
+    std::vector<Thread> threads_;
+};
+
+#endif /* THREAD_PLACEMENT_H */
@@ -0,0 +1,54 @@
+#include "ns3/core-module.h"
+#include "ns3/error-model.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "../helper/quic-network-simulator-helper.h"
+#include "../helper/quic-point-to-point-helper.h"
+#include "../helper/impairment-pipeline.h"
+
+using namespace ns3;
+using namespace std;
+
+NS_LOG_COMPONENT_DEFINE("ns3 simulator");
+
+int main(int argc, char *argv[]) {
+    std::string delay, bandwidth, queue, to_client, to_server;
+    CommandLine cmd;
+
+    cmd.AddValue("delay", "delay of the p2p link", delay);
+    cmd.AddValue("bandwidth", "bandwidth of the p2p link", bandwidth);
+    cmd.AddValue("queue", "queue size of the p2p link (in packets)", queue);
+    cmd.AddValue("to_client", "impairment stages (towards client), e.g. drop:rate=5+corrupt:rate=2", to_client);
+    cmd.AddValue("to_server", "impairment stages (towards server), e.g. drop:rate=5+corrupt:rate=2", to_server);
+    cmd.Parse (argc, argv);
+
+    NS_ABORT_MSG_IF(delay.length() == 0, "Missing parameter: delay");
+    NS_ABORT_MSG_IF(bandwidth.length() == 0, "Missing parameter: bandwidth");
+    NS_ABORT_MSG_IF(queue.length() == 0, "Missing parameter: queue");
+
+    QuicNetworkSimulatorHelper sim;
+
+    // Stick in the point-to-point line between the sides.
+    QuicPointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue(bandwidth));
+    p2p.SetChannelAttribute("Delay", StringValue(delay));
+    p2p.SetQueueSize(StringValue(queue + "p"));
+
+    NetDeviceContainer devices = p2p.Install(sim.GetLeftNode(), sim.GetRightNode());
+
+    // Both pipelines are created by the same helper, so that they share a
+    // rebind stage, if any.
+    ImpairmentPipelineHelper impairments;
+    Ptr<ImpairmentPipeline> client_impairments = impairments.Create(to_client, "to_client");
+    Ptr<ImpairmentPipeline> server_impairments = impairments.Create(to_server, "to_server");
+    client_impairments->SetCounters(CounterRegistry::Get().GetDirection("to_client"));
+    server_impairments->SetCounters(CounterRegistry::Get().GetDirection("to_server"));
+    if (!sim.SetIngressImpairments(client_impairments, server_impairments)) {
+        if (!client_impairments->IsEmpty())
+            devices.Get(0)->SetAttribute("ReceiveErrorModel", PointerValue(client_impairments));
+        if (!server_impairments->IsEmpty())
+            devices.Get(1)->SetAttribute("ReceiveErrorModel", PointerValue(server_impairments));
+    }
+
+    sim.Run(Seconds(36000));
+}
@@ -0,0 +1,67 @@
+#include "ns3/string.h"
+
+#include "../helper/quic-network-simulator-helper.h"
+#include "../helper/quic-point-to-point-helper.h"
+#include "ns3/core-module.h"
+#include "ns3/error-model.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "../helper/rebind-error-model.h"
+
+using namespace ns3;
+using namespace std;
+
+NS_LOG_COMPONENT_DEFINE("ns3 simulator");
+
+int main(int argc, char *argv[]) {
+  string delay, bandwidth, queue, mode, idle_timeout = "30s";
+  bool preserve_ports = true;
+  CommandLine cmd;
+  cmd.AddValue("delay", "delay of the p2p link", delay);
+  cmd.AddValue("bandwidth", "bandwidth of the p2p link", bandwidth);
+  cmd.AddValue("queue", "queue size of the p2p link (in packets)", queue);
+  cmd.AddValue("mode",
+               "NAT type (full-cone, address-restricted, port-restricted or "
+               "symmetric)",
+               mode);
+  cmd.AddValue("idle-timeout",
+               "expire bindings without packets for this long (0s: never)",
+               idle_timeout);
+  cmd.AddValue("preserve-ports",
+               "keep the client's port for new bindings, if it is free",
+               preserve_ports);
+  cmd.Parse(argc, argv);
+
+  NS_ABORT_MSG_IF(delay.length() == 0, "Missing parameter: delay");
+  NS_ABORT_MSG_IF(bandwidth.length() == 0, "Missing parameter: bandwidth");
+  NS_ABORT_MSG_IF(queue.length() == 0, "Missing parameter: queue");
+  NS_ABORT_MSG_IF(mode.length() == 0, "Missing parameter: mode");
+
+  QuicNetworkSimulatorHelper sim;
+
+  // Stick in the point-to-point line between the sides.
+  QuicPointToPointHelper p2p;
+  p2p.SetDeviceAttribute("DataRate", StringValue(bandwidth));
+  p2p.SetChannelAttribute("Delay", StringValue(delay));
+  p2p.SetQueueSize(StringValue(queue + "p"));
+
+  NetDeviceContainer devices =
+      p2p.Install(sim.GetLeftNode(), sim.GetRightNode());
+
+  // A NAT that never rebinds: bindings only change when they expire.
+  Ptr<RebindErrorModel> em = CreateObject<RebindErrorModel>();
+  em->SetMode(NatTable::ParseMode(mode));
+  em->SetPortPreservation(preserve_ports);
+  em->SetIdleTimeout(Time(idle_timeout));
+  em->SetCounters(CounterRegistry::Get().GetDirection("to_client"),
+                  CounterRegistry::Get().GetDirection("to_server"));
+  em->Enable();
+
+  devices.Get(0)->SetAttribute("ReceiveErrorModel", PointerValue(em));
+  devices.Get(1)->SetAttribute("ReceiveErrorModel", PointerValue(em));
+
+  cout << Simulator::Now().GetSeconds() << "s: " << mode << " NAT, idle timeout "
+       << idle_timeout << (preserve_ports ? ", preserving ports" : "") << endl;
+
+  sim.Run(Seconds(36000));
+}
@@ -6,7 +6,7 @@
 #include "ns3/error-model.h"
 #include "ns3/internet-module.h"
 #include "ns3/point-to-point-module.h"
-#include "rebind-error-model.h"
+#include "../helper/rebind-error-model.h"
 
 using namespace ns3;
 using namespace std;
@@ -20,7 +20,8 @@ void rebind(Ptr<RebindErrorModel> em, const Time next) {
 }
 
 int main(int argc, char *argv[]) {
-  string delay, bandwidth, queue, first_rebind = "0s", rebind_freq = "0s";
+  string delay, bandwidth, queue, first_rebind = "0s", rebind_freq = "0s",
+         idle_timeout = "0s";
   bool rebind_addr = false;
   CommandLine cmd;
   cmd.AddValue("delay", "delay of the p2p link", delay);
@@ -31,6 +32,9 @@ int main(int argc, char *argv[]) {
                rebind_freq);
   cmd.AddValue("rebind-addr", "change client IP address when rebinding",
                rebind_addr);
+  cmd.AddValue("idle-timeout",
+               "expire bindings without packets for this long (0s: never)",
+               idle_timeout);
   cmd.Parse(argc, argv);
 
   NS_ABORT_MSG_IF(delay.length() == 0, "Missing parameter: delay");
@@ -54,6 +58,9 @@ int main(int argc, char *argv[]) {
 
   Ptr<RebindErrorModel> em = CreateObject<RebindErrorModel>();
   em->SetRebindAddr(rebind_addr);
+  em->SetIdleTimeout(Time(idle_timeout));
+  em->SetCounters(CounterRegistry::Get().GetDirection("to_client"),
+                  CounterRegistry::Get().GetDirection("to_server"));
   em->Enable();
 
   devices.Get(0)->SetAttribute("ReceiveErrorModel", PointerValue(em));
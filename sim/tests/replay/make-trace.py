@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+"""Write an Ethernet pcap file with UDP/IPv4 flows, to replay with
+--ReplayLeft / --ReplayRight.
+
+Usage: make-trace.py <output.pcap> <flow> [<flow> ...]
+
+A flow is label,src,sport,dst,dport,start_ms,interval_ms,count: count
+packets from src:sport to dst:dport, the first at start_ms, then every
+interval_ms. The payload of packet i (from 1) of a flow is "<label> <i>",
+padded to 100 bytes, see udp-payloads.py."""
+
+import socket
+import struct
+import sys
+
+PAYLOAD_SIZE = 100
+
+
+def checksum(header):
+    s = sum(struct.unpack("!%dH" % (len(header) // 2), header))
+    while s > 0xffff:
+        s = (s & 0xffff) + (s >> 16)
+    return ~s & 0xffff
+
+
+def frame(src, sport, dst, dport, payload):
+    udp = struct.pack("!HHHH", sport, dport, 8 + len(payload), 0) + payload
+    ip = struct.pack("!BBHHHBBH4s4s", 0x45, 0, 20 + len(udp), 0, 0x4000, 64, 17, 0,
+                     socket.inet_aton(src), socket.inet_aton(dst))
+    ip = ip[:10] + struct.pack("!H", checksum(ip)) + ip[12:]
+    # The replay doesn't look at the MAC addresses.
+    eth = bytes.fromhex("020000000001") + bytes.fromhex("0242") + socket.inet_aton(src) + b"\x08\x00"
+    return eth + ip + udp
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit(__doc__)
+    packets = []
+    for flow in sys.argv[2:]:
+        label, src, sport, dst, dport, start, interval, count = flow.split(",")
+        for i in range(1, int(count) + 1):
+            t_us = (int(start) + (i - 1) * int(interval)) * 1000
+            payload = ("%s %d" % (label, i)).encode().ljust(PAYLOAD_SIZE, b"\0")
+            packets.append((t_us, frame(src, int(sport), dst, int(dport), payload)))
+    packets.sort(key=lambda p: p[0])
+    with open(sys.argv[1], "wb") as f:
+        f.write(struct.pack("<IHHiIII", 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+        for t_us, data in packets:
+            # Start at 1s, like a capture that didn't start at the epoch.
+            t_us += 1000000
+            f.write(struct.pack("<IIII", t_us // 1000000, t_us % 1000000, len(data), len(data)))
+            f.write(data)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,92 @@
+#!/bin/bash
+# Replays generated traces through the scenarios, with a fixed run seed, and
+# checks which packets reach the endpoints.
+#
+# Usage: tests/replay/run.sh <scratch directory>
+# where the scenario binaries are <scratch directory>/<name>/<name>[-<profile>].
+
+set -e
+
+SCRATCH=$(realpath "${1:?usage: $0 <scratch directory>}")
+TESTS=$(dirname "$(realpath "$0")")
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+CLIENT=193.167.0.100
+SERVER=193.167.100.100
+FAILED=0
+
+# 20 packets from the client, every 10ms.
+"$TESTS/make-trace.py" "$WORK/client.pcap" "c,$CLIENT,4433,$SERVER,443,0,10,20"
+# From 100ms on, 5 packets each from the server, from another port of the
+# server, and from another server, to the client's port.
+"$TESTS/make-trace.py" "$WORK/server.pcap" \
+  "s,$SERVER,443,$CLIENT,4433,100,10,5" \
+  "p,$SERVER,444,$CLIENT,4433,100,10,5" \
+  "a,193.167.100.200,443,$CLIENT,4433,100,10,5"
+
+# binary <scenario>: the path of the scenario's binary.
+binary() {
+  ls "$SCRATCH/$1/$1" "$SCRATCH/$1/$1"-* 2>/dev/null | head -n 1
+}
+
+# check <test> <side> <dst> <expected payloads> <scenario> [<arguments>...]
+# Runs the scenario, and compares the payloads of the packets to dst in the
+# output of side (left or right) with the expected ones, in any order.
+check() {
+  local test=$1 side=$2 dst=$3 expected=$4 scenario=$5
+  shift 5
+  local out="$WORK/$test"
+  if ! "$(binary "$scenario")" "$@" --delay=10ms --bandwidth=10Mbps --queue=25 \
+      --ReplayLeft="$WORK/client.pcap" --ReplayRight="$WORK/server.pcap" --ReplayOutput="$out" \
+      --RunSeed=1 --EventLogFile="$out.events.bin" --CountersFile="$out.counters.bin" --ControlSocket= \
+      > "$out.log" 2>&1; then
+    echo "FAIL $test: $scenario failed"
+    cat "$out.log"
+    FAILED=1
+    return
+  fi
+  local got
+  got=$("$TESTS/udp-payloads.py" "${out}_node_$side.pcap" "$dst" | sort -V | tr '\n' ' ')
+  expected=$(echo $expected | tr ' ' '\n' | paste -d ' ' - - | sort -V | tr '\n' ' ')
+  if [[ "$got" != "$expected" ]]; then
+    echo "FAIL $test: expected packets $expected"
+    echo "  got $got"
+    cat "$out.log"
+    FAILED=1
+    return
+  fi
+  echo "ok   $test"
+}
+
+# check_aborts <test> <message> <scenario> [<arguments>...]
+# Runs the scenario, and checks that it aborts with message.
+check_aborts() {
+  local test=$1 message=$2 scenario=$3
+  shift 3
+  local out="$WORK/$test"
+  if "$(binary "$scenario")" "$@" --delay=10ms --bandwidth=10Mbps --queue=25 \
+      --ReplayLeft="$WORK/client.pcap" --ReplayRight="$WORK/server.pcap" --ReplayOutput="$out" \
+      --EventLogFile= --CountersFile= --ControlSocket= > "$out.log" 2>&1 || ! grep -q -- "$message" "$out.log"; then
+    echo "FAIL $test: expected $scenario to abort with: $message"
+    cat "$out.log"
+    FAILED=1
+    return
+  fi
+  echo "ok   $test"
+}
+
+DROPPED="c 1 c 2 c 4 c 8 c 9 c 10 c 11 c 12 c 13 c 14 c 16 c 17 c 19 c 20"
+check droplist right $SERVER "$DROPPED" droplist --drops_to_server=3,5-7,15-/3
+check impairments-droplist right $SERVER "$DROPPED" impairments --to_server=droplist:3,5-7,15-/3
+
+ALL_SERVERS="s 1 s 2 s 3 s 4 s 5 p 1 p 2 p 3 p 4 p 5 a 1 a 2 a 3 a 4 a 5"
+check nat-full-cone left $CLIENT "$ALL_SERVERS" nat --mode=full-cone
+check nat-address-restricted left $CLIENT "s 1 s 2 s 3 s 4 s 5 p 1 p 2 p 3 p 4 p 5" nat --mode=address-restricted
+check nat-port-restricted left $CLIENT "s 1 s 2 s 3 s 4 s 5" nat --mode=port-restricted
+check nat-symmetric left $CLIENT "s 1 s 2 s 3 s 4 s 5" nat --mode=symmetric
+
+# Only the impairments and composed scenarios apply impairments at ingress.
+check_aborts parallel-impairments "ParallelImpairments is only supported" droplist --ParallelImpairments=1
+
+exit $FAILED
@@ -0,0 +1,35 @@
+#!/usr/bin/env python3
+"""Print the payloads written by make-trace.py of the UDP/IPv4 packets to
+dst in a pcap file, one per line, in the order of the file.
+
+Usage: udp-payloads.py <input.pcap> <dst>"""
+
+import socket
+import struct
+import sys
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    dst = socket.inet_aton(sys.argv[2])
+    with open(sys.argv[1], "rb") as f:
+        data = f.read()
+    magic = struct.unpack("<I", data[:4])[0]
+    endian = "<" if magic in (0xa1b2c3d4, 0xa1b23c4d) else ">"
+    pos = 24
+    while pos + 16 <= len(data):
+        incl_len = struct.unpack(endian + "I", data[pos + 8:pos + 12])[0]
+        packet = data[pos + 16:pos + 16 + incl_len]
+        pos += 16 + incl_len
+        if len(packet) < 14 + 28 or packet[12:14] != b"\x08\x00":
+            continue
+        ip = packet[14:]
+        if ip[9] != 17 or ip[16:20] != dst:
+            continue
+        payload = ip[(ip[0] & 0xf) * 4 + 8:]
+        print(payload.rstrip(b"\0").decode(errors="replace"))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,114 @@
+// counters-read polls the shared-memory counters file that the simulator
+// exports its live counters to (see scenarios/helper/counters.h), and prints
+// the counters, their rates, and a summary of the histograms.
+//
+// Usage: counters-read [--interval <ms>] [--once] [--csv] [file]
+//   --interval: the polling interval, 1000ms by default
+//   --once:     print the counters once and exit
+//   --csv:      print one line per counter and poll: time,name,value,rate
+//   file:       the counters file, /logs/counters.bin by default
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "counters-layout.h"
+
+using namespace std;
+
+static uint64_t Load(const uint64_t *v) {
+    return reinterpret_cast<const atomic<uint64_t> *>(v)->load(memory_order_relaxed);
+}
+
+// Returns the upper bound of the bucket that contains the q-quantile.
+static uint64_t Quantile(const CounterEntry *buckets, uint64_t count, double q) {
+    if (count == 0) return 0;
+    return HistogramQuantile(count, q, [buckets](uint32_t i) { return Load(&buckets[i].value); });
+}
+
+int main(int argc, char *argv[]) {
+    string filename = "/logs/counters.bin";
+    int interval_ms = 1000;
+    bool once = false, csv = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--interval") && i + 1 < argc) {
+            interval_ms = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--once")) {
+            once = true;
+        } else if (!strcmp(argv[i], "--csv")) {
+            csv = true;
+        } else {
+            filename = argv[i];
+        }
+    }
+    if (interval_ms <= 0) {
+        cerr << "invalid interval" << endl;
+        return 1;
+    }
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        perror(filename.c_str());
+        return 1;
+    }
+    struct stat st;
+    const size_t size = sizeof(CountersFileHeader) + kMaxCounterEntries * sizeof(CounterEntry);
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < size) {
+        cerr << filename << ": not a counters file" << endl;
+        return 1;
+    }
+    void *p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    const CountersFileHeader *header = static_cast<const CountersFileHeader *>(p);
+    const CounterEntry *entries = reinterpret_cast<const CounterEntry *>(header + 1);
+    if (memcmp(header->magic, kCountersMagic, sizeof(header->magic)) ||
+        header->version != kCountersVersion || header->entry_size != sizeof(CounterEntry)) {
+        cerr << filename << ": not a counters file, or written by another version" << endl;
+        return 1;
+    }
+
+    vector<uint64_t> previous(kMaxCounterEntries);
+    const double interval = interval_ms / 1000.0;
+    for (uint64_t poll = 0;; poll++) {
+        const uint32_t n = reinterpret_cast<const atomic<uint32_t> *>(&header->num_entries)
+                               ->load(memory_order_acquire);
+        const double t = poll * interval;
+        if (!csv) cout << "--- " << fixed << setprecision(1) << t << "s" << endl;
+        for (uint32_t i = 0; i < n; i++) {
+            const CounterEntry &e = entries[i];
+            if (e.kind == kCounterBucket) continue;
+            const uint64_t v = Load(&e.value);
+            const double rate = poll ? (v - previous[i]) / interval : 0;
+            previous[i] = v;
+            if (csv) {
+                cout << t << "," << e.name << "," << v << "," << rate << endl;
+                continue;
+            }
+            cout << setw(40) << left << e.name << right << setw(16) << v;
+            if (e.kind == kCounterMonotonic) {
+                cout << setw(14) << setprecision(1) << rate << "/s";
+            } else if (e.kind == kCounterHistogram && i + kHistogramBuckets < n) {
+                cout << "  p50 < " << Quantile(&e + 1, v, 0.5)
+                     << "  p99 < " << Quantile(&e + 1, v, 0.99);
+            }
+            cout << endl;
+        }
+        cout.flush();
+        if (once) break;
+        this_thread::sleep_for(chrono::milliseconds(interval_ms));
+    }
+    return 0;
+}
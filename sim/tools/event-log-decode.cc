@@ -0,0 +1,181 @@
+// event-log-decode prints a binary event log written by the simulator
+// (see scenarios/helper/event-log.h) in the text format that the scenarios
+// used to print to stdout.
+//
+// Usage: event-log-decode [--time] [file]
+//   --time: prefix every line with the simulation time
+//   file:   the event log, /logs/events.bin by default
+
+#include <arpa/inet.h>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "event-log-record.h"
+
+using namespace std;
+
+static string FormatAddress(uint8_t family, const uint8_t *addr) {
+    char buf[INET6_ADDRSTRLEN];
+    if (family == 6) {
+        inet_ntop(AF_INET6, addr, buf, sizeof(buf));
+        return "[" + string(buf) + "]";
+    }
+    inet_ntop(AF_INET, addr, buf, sizeof(buf));
+    return buf;
+}
+
+static string FormatFlow(const EventRecord &r) {
+    return FormatAddress(r.family, r.src) + ":" + to_string(r.src_port) + " -> " +
+           FormatAddress(r.family, r.dst) + ":" + to_string(r.dst_port);
+}
+
+static string FormatRatio(uint32_t n, uint32_t total) {
+    ostringstream os;
+    os << n << "/" << total << " (" << fixed << setprecision(1)
+       << (total ? (double)n / total * 100 : 0.0) << "%)";
+    return os.str();
+}
+
+static string FormatRate(const EventRecord &r) {
+    const uint64_t bps = r.arg[0] | (uint64_t)r.arg[1] << 32;
+    ostringstream os;
+    os << bps / 1e6 << "Mbps";
+    return os.str();
+}
+
+static void Print(const EventRecord &r, bool with_time) {
+    const double t = r.time / 1e9;
+    if (with_time && r.type < kEventFirstStateChange) cout << t << "s: ";
+    switch (r.type) {
+        case kEventDropRateForward:
+        case kEventDropRateDrop:
+            cout << (r.type == kEventDropRateDrop ? "Dropping " : "Forwarding ")
+                 << r.size << " bytes " << FormatFlow(r)
+                 << ", dropped " << FormatRatio(r.arg[0], r.arg[1]) << endl;
+            break;
+        case kEventCorruptForward:
+        case kEventCorrupt:
+            cout << (r.type == kEventCorrupt ? "Corrupting " : "Forwarding ")
+                 << r.size << " bytes " << FormatFlow(r);
+            if (r.type == kEventCorrupt)
+                cout << " offset " << r.arg[2] << " 0x" << hex << (r.arg16 >> 8)
+                     << " -> 0x" << (r.arg16 & 0xff) << dec;
+            cout << ", corrupted " << FormatRatio(r.arg[0], r.arg[1]) << endl;
+            break;
+        case kEventDroplistDrop:
+            cout << "Dropping packet " << r.arg[0] << " (" << r.size << " bytes) from "
+                 << FormatAddress(r.family, r.src) << endl;
+            break;
+        case kEventUnknownBinding:
+            if (r.arg16 == kNatFiltered)
+                cout << t << "s: binding " << FormatAddress(r.family, r.dst) << ":" << r.dst_port
+                     << " filters source " << FormatAddress(r.family, r.src) << ":" << r.src_port;
+            else if (r.arg16 == kNatPortsExhausted)
+                cout << t << "s: no free port for source " << FormatAddress(r.family, r.src) << ":"
+                     << r.src_port;
+            else
+                cout << t << "s: unknown binding for destination "
+                     << FormatAddress(r.family, r.dst) << ":" << r.dst_port;
+            cout << ", dropping packet" << endl;
+            break;
+        case kEventUnknownSource:
+            cout << t << "s: unknown source " << FormatAddress(r.family, r.src)
+                 << ", dropping packet" << endl;
+            break;
+        case kEventRebound:
+            cout << "Rebinding " << r.size << " bytes, "
+                 << (r.arg16 == kReboundSource ? "new source " : "new destination ")
+                 << (r.arg16 == kReboundSource ? FormatAddress(r.family, r.src) + ":" + to_string(r.src_port)
+                                               : FormatAddress(r.family, r.dst) + ":" + to_string(r.dst_port))
+                 << endl;
+            break;
+        case kEventLossModelDrop:
+            cout << "Dropping " << r.size << " bytes " << FormatFlow(r) << " ("
+                 << kLossModelNames[r.arg16 < 4 ? r.arg16 : 0] << ", state " << r.arg[2] << "), dropped "
+                 << FormatRatio(r.arg[0], r.arg[1]) << endl;
+            break;
+        case kEventComplexDrop:
+            if (r.arg16 == kComplexDropCyclic)
+                cout << "周期性丢包: 在时间 " << t << "s" << endl;
+            else if (r.arg16 == kComplexDropBurst)
+                cout << "随机丢包: 连续丢包还剩 " << r.arg[0] << " 个" << endl;
+            else
+                cout << "随机丢包: 触发连续丢包，将丢弃 " << r.arg[0] + 1 << " 个包" << endl;
+            break;
+        case kEventChannelDelay:
+            cout << "添加抖动: " << (int32_t)r.arg[0] / 1000.0 << "ms，传输延迟: "
+                 << r.arg[1] / 1000.0 << "ms" << endl;
+            break;
+        case kEventBlackholeOn:
+        case kEventBlackholeOff:
+            cout << t << "s: " << (r.type == kEventBlackholeOn ? "Enabling" : "Disabling")
+                 << " blackhole" << endl;
+            break;
+        case kEventRebind:
+            cout << t << "s:  rebinding: " << FormatAddress(r.family, r.src) << ":" << r.src_port
+                 << " -> " << FormatAddress(r.family, r.dst) << ":" << r.dst_port << endl;
+            break;
+        case kEventRebindAddress:
+            cout << t << "s:  rebinding address: " << FormatAddress(r.family, r.src)
+                 << " -> " << FormatAddress(r.family, r.dst) << endl;
+            break;
+        case kEventBindingExpired:
+            cout << t << "s:  binding expired: " << FormatAddress(r.family, r.src) << ":" << r.src_port
+                 << " -> " << FormatAddress(r.family, r.dst) << ":" << r.dst_port << endl;
+            break;
+        case kEventOverloaded:
+            cout << t << "s: simulator overloaded, running " << r.arg[0] << "us late" << endl;
+            break;
+        case kEventOverloadEnd:
+            cout << t << "s: simulator caught up after " << r.arg[0] << "us" << endl;
+            break;
+        case kEventLinkRate:
+            cout << t << "s: ";
+            switch (r.arg16) {
+                case kLinkRateHigh: cout << "切换到高带宽: "; break;
+                case kLinkRateLow: cout << "切换到低带宽: "; break;
+                case kLinkRateLinear: cout << "线性变化带宽: "; break;
+                case kLinkRatePeriodic: cout << "周期变化带宽: "; break;
+            }
+            cout << FormatRate(r) << endl;
+            break;
+        default:
+            cout << t << "s: unknown event type " << (int)r.type << endl;
+            break;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool with_time = false;
+    string filename = "/logs/events.bin";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--time") == 0)
+            with_time = true;
+        else
+            filename = argv[i];
+    }
+
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (!f) {
+        cerr << "Can't open " << filename << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    EventLogFileHeader hdr;
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 || memcmp(hdr.magic, kEventLogMagic, sizeof(hdr.magic)) != 0) {
+        cerr << filename << " is not an event log" << endl;
+        return 1;
+    }
+    if (hdr.version != kEventLogVersion || hdr.record_size != sizeof(EventRecord)) {
+        cerr << filename << ": unsupported event log version " << hdr.version << endl;
+        return 1;
+    }
+
+    EventRecord r;
+    while (fread(&r, sizeof(r), 1, f) == 1) Print(r, with_time);
+    fclose(f);
+    return 0;
+}
@@ -0,0 +1,85 @@
+// sim-control sends commands to the control socket of a running simulator
+// (see scenarios/helper/control-socket.h), and prints the replies.
+//
+// Usage: sim-control [--socket <path>] [command...]
+//   --socket: the control socket, /logs/control.sock by default
+//   command:  e.g. set to_client.link DataRate 5Mbps at 30s
+// Without a command, sim-control reads commands from stdin, one per line.
+// Exits with 1 if a command failed.
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Sends command, and prints the reply. Returns false if the command failed.
+static bool Send(int fd, const string &command, string &buffer) {
+    const string line = command + "\n";
+    if (write(fd, line.data(), line.size()) != (ssize_t)line.size()) {
+        perror("write");
+        return false;
+    }
+    char data[4096];
+    while (true) {
+        size_t end;
+        while ((end = buffer.find('\n')) != string::npos) {
+            const string reply = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            cout << reply << endl;
+            if (reply.compare(0, 2, "ok") == 0) return true;
+            if (reply.compare(0, 5, "error") == 0) return false;
+        }
+        const ssize_t n = read(fd, data, sizeof(data));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            cerr << "the simulator closed the connection" << endl;
+            return false;
+        }
+        buffer.append(data, n);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    string path = "/logs/control.sock";
+    string command;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--socket") && i + 1 < argc) {
+            path = argv[++i];
+        } else {
+            if (!command.empty()) command += " ";
+            command += argv[i];
+        }
+    }
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        cerr << path << ": path too long" << endl;
+        return 1;
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror(path.c_str());
+        return 1;
+    }
+
+    string buffer;
+    bool ok = true;
+    if (!command.empty()) {
+        ok = Send(fd, command, buffer);
+    } else {
+        string line;
+        while (getline(cin, line))
+            if (line.find_first_not_of(" \t\r") != string::npos) ok = Send(fd, line, buffer) && ok;
+    }
+    close(fd);
+    return ok ? 0 : 1;
+}